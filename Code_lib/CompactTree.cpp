@@ -0,0 +1,84 @@
+#include "CompactTree.h"
+#include <stdexcept>
+#include <string>
+
+// Constructor : Starts empty
+CompactTree::CompactTree() : symbols(nullptr) {}
+
+// Tag of a TreeNode
+static NodeTag tagOf(const ExpressionTree::TreeNode& node) {
+    if (node.kind == TokenKind::Number) return NodeTag::Number;
+    if (node.kind == TokenKind::Variable) return NodeTag::Variable;
+    if (node.op == OpCode::None) throw std::runtime_error("Invalid operator!");
+    return operatorTag(node.op);
+}
+
+// Copies the tree at root in pre-order with an explicit stack.
+// Each entry remembers which child index of which node it has to fill in.
+void CompactTree::assign(ExpressionTree& tree, const ExpressionTree::TreeNode* root) {
+    nodes.clear();
+    symbols = tree.symbols;
+    if (!root) return;
+
+    struct Pending {
+        const ExpressionTree::TreeNode* node;
+        uint32_t parent;  // Index of the parent (unused for the root)
+        bool right;       // True if the node is its parent's right child
+    };
+    std::vector<Pending> stack;
+    stack.push_back({root, 0, false});
+    while (!stack.empty()) {
+        Pending entry = stack.back();
+        stack.pop_back();
+        const ExpressionTree::TreeNode& node = *entry.node;
+        const uint32_t index = static_cast<uint32_t>(nodes.size());
+        if (index > 0) {
+            if (entry.right) nodes[entry.parent].right = index; else nodes[entry.parent].left = index;
+        }
+
+        CompactNode compact;
+        compact.tag = tagOf(node);
+        compact.left = 0;
+        compact.number = 0;
+        if (compact.tag == NodeTag::Number) {
+            compact.number = node.number;
+        } else if (compact.tag == NodeTag::Variable) {
+            compact.left = node.symbol;
+        } else {
+            if (!node.left || !node.right) throw std::runtime_error("Invalid operator!");
+            // The left child is popped, and so laid out, first.
+            stack.push_back({node.right, index, true});
+            stack.push_back({node.left, index, false});
+        }
+        nodes.push_back(compact);
+    }
+}
+
+// Evaluates the tree in one backward pass over the nodes. Both children of an
+// operator come after it, so their values are on the stack when it is reached:
+// the left one on top, since the left subtree comes first in pre-order.
+double CompactTree::evaluate(const VariableBindings& variableValues) const {
+    if (nodes.empty()) return 0;
+    std::vector<double> values;
+    values.reserve(32);
+
+    for (size_t i = nodes.size(); i-- > 0;) {
+        const CompactNode& node = nodes[i];
+        if (node.tag == NodeTag::Number) {
+            values.push_back(node.number);
+            continue;
+        }
+        if (node.tag == NodeTag::Variable) {
+            const double* value = variableValues.find(node.left);
+            if (!value) throw std::runtime_error("Undefined variable: " + std::string(symbols->name(node.left)));
+            values.push_back(*value);
+            continue;
+        }
+
+        const double left = values.back();
+        values.pop_back();
+        double& right = values.back();  // Right operand, replaced by the result
+        right = applyOperator(tagOperator(node.tag), left, right);
+    }
+    return values.back();
+}
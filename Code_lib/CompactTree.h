@@ -0,0 +1,80 @@
+#ifndef COMPACT_TREE_H
+#define COMPACT_TREE_H
+
+#include <cstdint>
+#include <vector>
+#include "ExpressionTree.h"
+#include "SymbolTable.h"
+
+// Node tags of a compact tree. Each operator has its own tag so evaluation is one
+// switch; operator tags have the values of their OpCode, so the arithmetic is
+// applyOperator, shared with every other evaluator.
+enum class NodeTag : uint8_t {
+    Number = static_cast<uint8_t>(OpCode::None),
+    Add = static_cast<uint8_t>(OpCode::Add),
+    Subtract = static_cast<uint8_t>(OpCode::Subtract),
+    Multiply = static_cast<uint8_t>(OpCode::Multiply),
+    Divide = static_cast<uint8_t>(OpCode::Divide),
+    Modulo = static_cast<uint8_t>(OpCode::Modulo),
+    Power = static_cast<uint8_t>(OpCode::Power),
+    Variable
+};
+
+// Returns the operator code of an operator tag
+inline OpCode tagOperator(NodeTag tag) {
+    return static_cast<OpCode>(tag);
+}
+
+// Returns the tag of an operator code other than OpCode::None
+inline NodeTag operatorTag(OpCode op) {
+    return static_cast<NodeTag>(op);
+}
+
+// Returns true for the tags of binary operators
+inline bool isOperatorTag(NodeTag tag) {
+    return tag >= NodeTag::Add && tag <= NodeTag::Power;
+}
+
+/*
+ * CompactNode struct: A 16-byte tree node. Operators keep their children as 32-bit
+ * indices into the node array; leaves keep their value (or symbol id) in the same space.
+ */
+struct CompactNode {
+    NodeTag tag;
+    uint32_t left;       // Left child index (operators) or symbol id (variables)
+    union {
+        double number;   // Value (numbers)
+        uint32_t right;  // Right child index (operators)
+    };
+};
+static_assert(sizeof(CompactNode) == 16, "CompactNode is meant to be 16 bytes");
+
+/*
+ * CompactTree class: An expression tree stored as one array of CompactNode in
+ * pre-order, copied from a TreeNode tree.
+ * A node's children always come after it, so scanning the array backwards reaches
+ * both children of an operator before the operator itself: evaluation is a single
+ * backward pass with a stack of values and a switch over the tag, with no pointers
+ * to chase and no strings to compare.
+ */
+class CompactTree {
+private:
+    std::vector<CompactNode> nodes;  // Pre-order; nodes[0] is the root
+    const SymbolTable* symbols;      // Names of variable ids, for error messages
+
+public:
+    // Constructor : Starts empty
+    CompactTree();
+
+    // Copies the tree at root; variable names without an id are interned into the tree's table
+    void assign(ExpressionTree& tree, const ExpressionTree::TreeNode* root);
+    // Evaluates with values indexed by symbol id
+    double evaluate(const VariableBindings& variableValues) const;
+
+    // Returns the number of nodes
+    size_t size() const { return nodes.size(); }
+    // Provides read access to a node by index
+    const CompactNode& operator[](size_t index) const { return nodes[index]; }
+};
+
+#endif // COMPACT_TREE_H
@@ -0,0 +1,399 @@
+#ifndef COMPILED_EXPRESSION_H
+#define COMPILED_EXPRESSION_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "SymbolTable.h"
+#include "Token.h"
+
+/*
+ * Compile-time infix expressions.
+ *
+ *     auto area = ET_COMPILE("( AX * BX ) + 3");
+ *     area.bind(symbols);                  // Resolve AX and BX to symbol ids once
+ *     double value = area.evaluate(bindings);
+ *
+ * ET_COMPILE lexes and parses the string literal while the program is compiled,
+ * with the tokens and grammar of buildTreeFromInfix (precedence, right-associative ^,
+ * negative literals after a space, operator or '('). The result's type spells the
+ * expression out as nested templates, so evaluate() is straight-line arithmetic the
+ * compiler can inline completely; nothing is tokenized or parsed when the program runs.
+ * A malformed literal fails to compile at the check that rejects it, whose text is
+ * the runtime error message.
+ * Number literals are exact when their digits fit in 53 bits and the decimal exponent
+ * is at most 22 in size, which covers any literal short enough to write by hand.
+ */
+
+namespace ExpressionTemplates {
+
+// Node and token kinds of the compile-time parser
+enum class Kind : uint8_t { Number, Variable, Operator, LeftParen, RightParen };
+
+// One token of the literal
+struct Lexeme {
+    Kind kind = Kind::Number;
+    OpCode op = OpCode::None;
+    size_t begin = 0;                 // Position in the literal
+    size_t length = 0;
+    unsigned long long mantissa = 0;  // Digits of a number without the decimal point
+    int exponent = 0;                 // Power of ten the mantissa is scaled by
+    bool negative = false;
+};
+
+// One node of the parsed expression
+struct Node {
+    Kind kind = Kind::Number;
+    OpCode op = OpCode::None;
+    int left = -1;
+    int right = -1;
+    int slot = 0;                     // Variable slot (order of first use)
+    int token = 0;                    // Token the node was made from
+};
+
+constexpr bool isSpace(char ch) { return ch == ' ' || (ch >= '\t' && ch <= '\r'); }
+constexpr bool isDigit(char ch) { return ch >= '0' && ch <= '9'; }
+constexpr bool isAlpha(char ch) { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'); }
+constexpr bool isDelimiter(char ch) {
+    return isSpace(ch) || ch == '+' || ch == '-' || ch == '*' || ch == '/' || ch == '%' || ch == '^' ||
+           ch == '(' || ch == ')';
+}
+
+constexpr OpCode operatorCode(char ch) {
+    switch (ch) {
+        case '+': return OpCode::Add;
+        case '-': return OpCode::Subtract;
+        case '*': return OpCode::Multiply;
+        case '/': return OpCode::Divide;
+        case '%': return OpCode::Modulo;
+        case '^': return OpCode::Power;
+        default: return OpCode::None;
+    }
+}
+
+// Same precedences as ExpressionTree::precedence
+constexpr int precedence(OpCode op) {
+    return op == OpCode::Power ? 3 : (op == OpCode::Add || op == OpCode::Subtract) ? 1 : 2;
+}
+
+// Parsed form of a literal of Length characters (never more tokens or nodes than characters)
+template<size_t Length>
+struct Parsed {
+    static constexpr size_t Capacity = Length > 0 ? Length : 1;
+
+    std::string_view text;
+    Lexeme tokens[Capacity] = {};
+    int tokenCount = 0;
+    Node nodes[Capacity] = {};
+    int nodeCount = 0;
+    size_t variables[Capacity] = {};      // Token index of the first use of each variable slot
+    int variableCount = 0;
+    int operatorCount = 0;
+    int root = -1;
+    int position = 0;                     // Next token while parsing
+
+    constexpr explicit Parsed(std::string_view literal) : text(literal) {
+        lex();
+        if (tokenCount == 0) {
+            throw "Empty expression. Enter an expression made of numbers, variables, operators, and parentheses";
+        }
+        if (tokens[0].kind == Kind::Operator) {
+            throw "Incorrect expression type. Expected Infix, but got Prefix expression.";
+        }
+        if (tokens[tokenCount - 1].kind == Kind::Operator) {
+            throw "Incorrect expression type. Expected Infix, but got Postfix expression.";
+        }
+        root = parseExpression(0);
+        if (position < tokenCount) throw "Unbalanced parentheses: Too many closing parentheses";
+        if (operatorCount == 0) throw "Unable to determine expression type";
+    }
+
+    // Splits the literal into tokens with the rules of Lexer.
+    constexpr void lex() {
+        const size_t size = text.size();
+        size_t i = 0;
+        bool afterOperand = false;
+        while (i < size) {
+            const char ch = text[i];
+            if (isSpace(ch)) {
+                afterOperand = false;  // "5 -3" is two numbers
+                ++i;
+                continue;
+            }
+            Lexeme token;
+            token.begin = i;
+            const bool signedNumber = ch == '-' && !afterOperand && i + 1 < size &&
+                                      (isDigit(text[i + 1]) || text[i + 1] == '.');
+            if (isDigit(ch) || ch == '.' || signedNumber) {
+                token.kind = Kind::Number;
+                token.negative = signedNumber;
+                if (signedNumber) ++i;
+                int digits = 0;
+                bool dot = false;
+                bool any = false;
+                for (; i < size && (isDigit(text[i]) || (text[i] == '.' && !dot)); ++i) {
+                    if (text[i] == '.') {
+                        dot = true;
+                        continue;
+                    }
+                    any = true;
+                    if (digits == 0 && text[i] == '0') {
+                        if (dot) --token.exponent;
+                        continue;
+                    }
+                    if (++digits > 19) throw "Number literal has too many digits for a compiled expression";
+                    token.mantissa = token.mantissa * 10 + static_cast<unsigned long long>(text[i] - '0');
+                    if (dot) --token.exponent;
+                }
+                if (!any || (i < size && !isDelimiter(text[i]))) throw "Invalid token in infix expression";
+                afterOperand = true;
+            } else if (isAlpha(ch)) {
+                token.kind = Kind::Variable;
+                while (i < size && (isAlpha(text[i]) || isDigit(text[i]))) ++i;
+                if (i < size && !isDelimiter(text[i])) throw "Invalid token in infix expression";
+                afterOperand = true;
+            } else if (ch == '(' || ch == ')') {
+                token.kind = ch == '(' ? Kind::LeftParen : Kind::RightParen;
+                ++i;
+                afterOperand = ch == ')';
+            } else if (operatorCode(ch) != OpCode::None) {
+                token.kind = Kind::Operator;
+                token.op = operatorCode(ch);
+                ++i;
+                afterOperand = false;
+            } else {
+                throw "Invalid token in infix expression";
+            }
+            token.length = i - token.begin;
+            tokens[tokenCount++] = token;
+        }
+    }
+
+    // Returns the slot of a variable token, giving new names the next slot.
+    constexpr int slotOf(const Lexeme& token) {
+        const std::string_view name = text.substr(token.begin, token.length);
+        for (int slot = 0; slot < variableCount; ++slot) {
+            const Lexeme& first = tokens[variables[slot]];
+            if (text.substr(first.begin, first.length) == name) return slot;
+        }
+        variables[variableCount] = static_cast<size_t>(&token - tokens);
+        return variableCount++;
+    }
+
+    // Precedence climbing with the binding powers of the runtime parser.
+    constexpr int parseExpression(int minPower) {
+        int left = parseOperand();
+        while (position < tokenCount) {
+            const Lexeme& token = tokens[position];
+            if (token.kind == Kind::RightParen) break;
+            if (token.kind == Kind::LeftParen) throw "Invalid syntax: Missing operator before opening parenthesis";
+            if (token.kind != Kind::Operator) throw "Invalid syntax: Missing operator between operands";
+            const int power = 2 * precedence(token.op);
+            if (power < minPower) break;
+            ++position;
+            ++operatorCount;
+            const int right = parseExpression(token.op == OpCode::Power ? power : power + 1);
+            Node node;
+            node.kind = Kind::Operator;
+            node.op = token.op;
+            node.token = position - 1;
+            node.left = left;
+            node.right = right;
+            nodes[nodeCount] = node;
+            left = nodeCount++;
+        }
+        return left;
+    }
+
+    // Parses a number, a variable or a parenthesized group.
+    constexpr int parseOperand() {
+        if (position >= tokenCount) throw "Incomplete expression: Not enough operands for operators";
+        const Lexeme& token = tokens[position];
+        if (token.kind == Kind::LeftParen) {
+            ++position;
+            const int inner = parseExpression(0);
+            if (position >= tokenCount) throw "Unbalanced parentheses";
+            ++position;
+            return inner;
+        }
+        if (token.kind == Kind::Operator) {
+            if (position > 0 && tokens[position - 1].kind == Kind::Operator) throw "Invalid syntax: Consecutive operators";
+            throw "Incomplete expression: Not enough operands for operators";
+        }
+        if (token.kind == Kind::RightParen) throw "Incomplete expression: Not enough operands for operators";
+        ++position;
+        Node node;
+        node.kind = token.kind;
+        node.token = position - 1;
+        if (token.kind == Kind::Variable) node.slot = slotOf(token);
+        nodes[nodeCount] = node;
+        return nodeCount++;
+    }
+};
+
+// Value of mantissa * 10^exponent: exact in the range a hand-written literal uses.
+constexpr double literalValue(unsigned long long mantissa, int exponent, bool negative) {
+    constexpr double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    double value = static_cast<double>(mantissa);
+    int scale = exponent;
+    for (; scale > 22; scale -= 22) value *= powers[22];
+    for (; scale < -22; scale += 22) value /= powers[22];
+    value = scale >= 0 ? value * powers[scale] : value / powers[-scale];
+    return negative ? -value : value;
+}
+
+// Number literal leaf; Begin and Length locate its text in the literal
+template<unsigned long long Mantissa, int Exponent, bool Negative, size_t Begin, size_t Length>
+struct Number {
+    static constexpr double value = literalValue(Mantissa, Exponent, Negative);
+
+    template<typename Values>
+    static double evaluate(const Values&) { return value; }
+
+    static void write(std::string& output, std::string_view text) { output += text.substr(Begin, Length); }
+};
+
+// Variable leaf, read from the slot given to its name
+template<int Slot, size_t Begin, size_t Length>
+struct Variable {
+    template<typename Values>
+    static double evaluate(const Values& values) { return values.value(Slot); }
+
+    static void write(std::string& output, std::string_view text) { output += text.substr(Begin, Length); }
+};
+
+// Binary operator node
+template<OpCode Op, typename Left, typename Right>
+struct Binary {
+    template<typename Values>
+    static double evaluate(const Values& values) {
+        const double left = Left::evaluate(values);
+        const double right = Right::evaluate(values);
+        return applyOperator(Op, left, right);  // Op is a constant, so only its case is compiled in
+    }
+
+    // Writes the same fully parenthesized text as ExpressionTree::inorder.
+    static void write(std::string& output, std::string_view text) {
+        output += "( ";
+        Left::write(output, text);
+        output += ' ';
+        output += opText(Op);
+        output += ' ';
+        Right::write(output, text);
+        output += " )";
+    }
+};
+
+// Turns node Index of the literal returned by source into its template type.
+// Each instantiation parses the literal again; only types leave the function.
+template<int Index, typename Source>
+constexpr auto buildType(Source source) {
+    constexpr Parsed<source().size()> parsed(source());
+    constexpr Node node = parsed.nodes[Index];
+    constexpr Lexeme token = parsed.tokens[node.token];
+    if constexpr (node.kind == Kind::Operator) {
+        using Left = decltype(buildType<node.left>(source));
+        using Right = decltype(buildType<node.right>(source));
+        return Binary<node.op, Left, Right>{};
+    } else if constexpr (node.kind == Kind::Variable) {
+        return Variable<node.slot, token.begin, token.length>{};
+    } else {
+        return Number<token.mantissa, token.exponent, token.negative, token.begin, token.length>{};
+    }
+}
+
+// Values looked up through symbol ids in VariableBindings
+template<size_t Count>
+struct BoundValues {
+    const VariableBindings& bindings;
+    const std::array<uint32_t, Count>& ids;
+    const std::array<std::string_view, Count>& names;
+
+    double value(int slot) const {
+        const double* found = bindings.find(ids[slot]);
+        if (!found) throw std::runtime_error("Undefined variable: " + std::string(names[slot]));
+        return *found;
+    }
+};
+
+// Values given directly, one per slot
+struct SlotValues {
+    const double* values;
+
+    double value(int slot) const { return values[slot]; }
+};
+
+} // namespace ExpressionTemplates
+
+/*
+ * CompiledExpression class: An expression parsed at compile time. Tree is the
+ * expression-template type; variables are numbered by first use in the literal.
+ */
+template<typename Tree, size_t VariableCount>
+class CompiledExpression {
+private:
+    std::string_view text;                              // The literal the expression was compiled from
+    std::array<std::string_view, VariableCount> names;  // Variable names, by slot
+    std::array<uint32_t, VariableCount> ids;            // Symbol id of each slot once bound
+
+public:
+    using TreeType = Tree;
+
+    // Constructor : Keeps the variable names; nothing is bound yet
+    CompiledExpression(std::string_view literal, const std::array<std::string_view, VariableCount>& variableNames)
+        : text(literal), names(variableNames) {
+        ids.fill(SymbolTable::NoSymbol);
+    }
+
+    // Interns the variable names so evaluate can read bindings made with symbols
+    void bind(SymbolTable& symbols) {
+        for (size_t slot = 0; slot < VariableCount; ++slot) ids[slot] = symbols.intern(names[slot]);
+    }
+
+    // Evaluates with variable values from bindings (after bind)
+    double evaluate(const VariableBindings& bindings) const {
+        return Tree::evaluate(ExpressionTemplates::BoundValues<VariableCount>{bindings, ids, names});
+    }
+
+    // Evaluates with one value per variable slot
+    double evaluate(const double* values) const {
+        return Tree::evaluate(ExpressionTemplates::SlotValues{values});
+    }
+
+    // Returns the fully parenthesized infix text, as ExpressionTree::inorder would
+    std::string inorder() const {
+        std::string output;
+        Tree::write(output, text);
+        return output;
+    }
+
+    static constexpr size_t variableCount() { return VariableCount; }
+    std::string_view variable(size_t slot) const { return names[slot]; }
+};
+
+namespace ExpressionTemplates {
+
+// Parses the literal returned by source and wraps its type in a CompiledExpression.
+template<typename Source>
+auto compile(Source source) {
+    constexpr Parsed<source().size()> parsed(source());
+    using Tree = decltype(buildType<parsed.root>(source));
+    std::array<std::string_view, parsed.variableCount> names{};
+    for (int slot = 0; slot < parsed.variableCount; ++slot) {
+        const Lexeme& token = parsed.tokens[parsed.variables[slot]];
+        names[slot] = source().substr(token.begin, token.length);
+    }
+    return CompiledExpression<Tree, parsed.variableCount>(source(), names);
+}
+
+} // namespace ExpressionTemplates
+
+// Parses an infix string literal at compile time (see above)
+#define ET_COMPILE(literal) \
+    ::ExpressionTemplates::compile([]() constexpr { return std::string_view(literal); })
+
+#endif // COMPILED_EXPRESSION_H
@@ -0,0 +1,37 @@
+#ifndef DIAGNOSTIC_H
+#define DIAGNOSTIC_H
+
+#include <cstdint>
+#include <string>
+
+// Kinds of problems the parser reports.
+enum class DiagnosticCode : uint8_t {
+    EmptyExpression,                   // Nothing to parse
+    WrongExpressionType,               // The input is not in the requested notation
+    UnknownExpressionType,             // The notation cannot be told from the input
+    InvalidToken,                      // Malformed or misplaced token such as 3.14.5, 1x or a parenthesis in postfix
+    MissingOperatorBeforeParenthesis,  // "A ( B )"
+    TooManyClosingParentheses,         // ")" without a matching "("
+    UnbalancedParentheses,             // "(" without a matching ")"
+    OperatorAtEdge,                    // Infix operator at the start or end
+    ConsecutiveOperators,              // "A + * B"
+    MissingOperatorBetweenOperands,    // "A B" or "( A ) B"
+    NotEnoughOperands,                 // Infix operators outnumber operands
+    InsufficientOperands,              // Prefix or postfix operator without two operands
+    IncorrectOperandCount,             // Prefix or postfix input does not reduce to one value
+    MalformedExpression                // Rejected by the parser though no single check above names the problem
+};
+
+/*
+ * Diagnostic struct: One problem found in an expression.
+ * tokenIndex and offset point at the offending token; problems with the
+ * expression as a whole have tokenIndex -1.
+ */
+struct Diagnostic {
+    DiagnosticCode code;
+    int tokenIndex;        // Index of the offending token, or -1
+    uint64_t offset;       // Source offset of the offending token (0 when tokenIndex is -1)
+    std::string message;   // Same text the throwing validators use
+};
+
+#endif // DIAGNOSTIC_H
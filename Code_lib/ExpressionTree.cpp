@@ -1,14 +1,121 @@
 #include "ExpressionTree.h"
-#include "MyStack.h"
+#include "Lexer.h"
+#include "NumberParser.h"
+#include "StructuralIndex.h"
+#include "ThreadPool.h"
 #include <stdexcept>
 #include <cmath>
-#include <sstream>
-#include <functional>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <optional>
 
 // Constructors and destructors
-ExpressionTree::ExpressionTree() {root = NULL;}
-ExpressionTree::~ExpressionTree() {}
+ExpressionTree::ExpressionTree() : ownedSymbols(std::make_unique<SymbolTable>()), symbols(ownedSymbols.get()) {}
+ExpressionTree::ExpressionTree(SymbolTable& sharedSymbols) : symbols(&sharedSymbols) {}
+ExpressionTree::~ExpressionTree() {
+    root.release();  // The arena hands its blocks back whole; no node needs visiting
+}
+
+// Frees every tree built by this tree at once: the arena drops its blocks without
+// visiting a node, and the spelling text goes with them. Raw roots of those trees
+// dangle afterwards, and handles to them (including root) are emptied or free nothing.
+void ExpressionTree::reset() {
+    root.release();
+    arena.release();
+    std::string().swap(spellingText);
+    std::vector<SpellingRegion>().swap(spellingRegions);
+}
+
+// Returns the text of a node as written in the source: a variable's name, a number's
+// literal or an operator's symbol. A literal runs from its position in spellingText to
+// the first character that cannot continue it (an optional '-', then digits and '.').
+std::string_view ExpressionTree::spelling(const TreeNode* node) const {
+    if (node->kind == TokenKind::Operator) return opText(node->op);
+    if (node->kind == TokenKind::Variable) return symbols->name(node->symbol);
+    const std::string_view text = std::string_view(spellingText).substr(node->symbol);
+    size_t length = !text.empty() && text[0] == '-' ? 1 : 0;
+    while (length < text.size() && ((text[length] >= '0' && text[length] <= '9') || text[length] == '.')) ++length;
+    return text.substr(0, length);
+}
+
+// Copies the source text of tokens [begin, end) to the end of spellingText as a new
+// region, once per build rather than once per number, followed by a space that ends
+// the last literal. Every number token in the range must become a node. Returns the
+// shift that turns a token offset into the position of its copy; nodes keep that
+// position in 32 bits, so the text of live trees is limited to 4 GiB.
+uint64_t ExpressionTree::keepSpellings(const TokenList& tokens, int begin, int end) {
+    size_t numbers = 0;
+    for (int i = begin; i < end; ++i) numbers += tokens[i].kind == TokenKind::Number;
+    if (numbers == 0) return 0;  // Nothing will point into the text
+    const uint64_t first = tokens[begin].offset;
+    const uint64_t last = tokens[end - 1].offset + tokens[end - 1].length;
+    if (spellingText.size() + (last - first) >= SymbolTable::NoSymbol) {
+        throw std::runtime_error("Expression text too large: live trees are limited to 4 GiB of source");
+    }
+    const uint64_t shift = spellingText.size() - first;
+    spellingText.append(tokens.source, first, last - first);
+    spellingText += ' ';
+    spellingRegions.push_back({spellingText.size(), numbers});
+    return shift;
+}
+
+// Releases the spelling of a number node. Once the last regions of spellingText have
+// no number nodes left their text is cut off, so trees that are built and dropped
+// while others live do not make the text grow.
+void ExpressionTree::dropSpelling(const TreeNode* node) {
+    if (node->kind != TokenKind::Number) return;
+    auto region = std::upper_bound(spellingRegions.begin(), spellingRegions.end(), uint64_t(node->symbol),
+                                   [](uint64_t position, const SpellingRegion& r) { return position < r.end; });
+    if (region == spellingRegions.end()) return;  // Text of a build that is being taken back
+    --region->numbers;
+    while (!spellingRegions.empty() && spellingRegions.back().numbers == 0) spellingRegions.pop_back();
+    spellingText.resize(spellingRegions.empty() ? 0 : spellingRegions.back().end);
+}
+
+// Spelling text of one build: copied when the build starts and taken back unless
+// keep() is called, so a failed build leaves spellingText as it was.
+class BuildSpellings {
+    ExpressionTree& tree;
+    size_t mark;
+    bool kept = false;
+public:
+    uint64_t shift;  // From keepSpellings, for the nodes of the build
+
+    BuildSpellings(ExpressionTree& owner, const TokenList& tokens, int begin, int end)
+        : tree(owner), mark(owner.spellingText.size()), shift(owner.keepSpellings(tokens, begin, end)) {}
+    ~BuildSpellings() {
+        if (kept) return;
+        std::vector<ExpressionTree::SpellingRegion>& regions = tree.spellingRegions;
+        while (!regions.empty() && (regions.back().end > mark || regions.back().numbers == 0)) regions.pop_back();
+        tree.spellingText.resize(regions.empty() ? 0 : regions.back().end);
+    }
+    BuildSpellings(const BuildSpellings&) = delete;
+    BuildSpellings& operator=(const BuildSpellings&) = delete;
+
+    // Returns root, keeping the text if it is a tree
+    ExpressionTree::TreeNode* keep(ExpressionTree::TreeNode* root) {
+        kept = root != nullptr;
+        return root;
+    }
+};
+
+// Classifies a single string token with the lexer.
+// The whole string must lex as exactly one token, otherwise it is Invalid.
+static Token classifyToken(std::string_view text) {
+    Lexer lexer(text);
+    Token token;
+    Token extra;
+    if (!lexer.next(token) || token.length != text.size() || lexer.next(extra)) {
+        token.kind = TokenKind::Invalid;
+        token.op = OpCode::None;
+        token.number = 0;
+    }
+    token.offset = 0;
+    token.length = static_cast<uint32_t>(text.size());
+    return token;
+}
 
 // Helper function to check if a token is a mathematical operator (+, -, *, /, %, ^).
 // Returns true if the token is a valid operator, false otherwise.
@@ -17,7 +124,13 @@ bool ExpressionTree::isOperator(const std::string& token) const {
 
 }
 // Validates the balance of parentheses in an infix expression
+// Large inputs are checked by the vectorized structural index instead.
 bool ExpressionTree::isValidParentheses(const std::string& expression) const {
+    if (expression.size() >= StructuralIndex::MinimumInputSize) {
+        StructuralIndex index;
+        if (index.build(expression, false)) return index.balancedParentheses();
+    }
+
     int balance = 0; // Tracks the balance of parentheses
     for (char ch : expression) {
         if (ch == '(') {
@@ -78,530 +191,1330 @@ int ExpressionTree::precedence(const std::string& op) {
     return 0;  // Unknown operators have precedence 0.
 }
 
-// Recursively deletes all nodes in the tree to prevent memory leaks
-// Traverses the tree in postorder to delete nodes.
-void ExpressionTree::deleteTree(TreeNode* root) {
-    if (!root) return;
-    deleteTree(root->left);
-    deleteTree(root->right);
-    delete root;
+// Determines operator precedence from an operator code (table lookup, no string comparison)
+int ExpressionTree::precedence(OpCode op) {
+    static const int precedences[] = {0, 1, 1, 2, 2, 2, 3};
+    return precedences[static_cast<int>(op)];
 }
 
+// Lexes an expression into typed tokens, interning variable names in symbols when given.
+static void lexTokens(std::string_view expression, TokenList& tokens, SymbolTable* symbols) {
+    tokens.source.assign(expression.data(), expression.size());
+    tokens.tokens.clear();
 
-// Tree building functions
-// Builds an expression tree from an infix expression.
-// Validates the expression structure, tokenizes the input, and constructs the tree using stacks for nodes and operators.
-ExpressionTree::TreeNode* ExpressionTree::buildTreeFromInfix(const std::string& infix) {
-  MyVector tokens = tokenize(infix); // Tokenize the infix expression.
-    // simple Validation for the structure of the infix expression
-    if (tokens.getSize() < 3) {
-        throw std::runtime_error("Incomplete expression: Not enough operands");
-    }
-
-    // New validation function to check expression structure
-    validateExpressionStructure(tokens);
+    StructuralIndex index;
+    bool indexed = expression.size() >= StructuralIndex::MinimumInputSize && index.build(tokens.source);
+    Lexer lexer(tokens.source, symbols, indexed ? &index : nullptr);
+    Token token;
 
-    //  Initialize stacks for tree nodes and operators.
-    MyStack<TreeNode*> nodes;
-    MyStack<string> ops;
+    while (lexer.next(token)) {
+        tokens.tokens.push_back(token);
+    }
+}
 
-    // Process tokens one by one.
+// Classifies a vector of string tokens, leaving variable names uninterned (NoSymbol).
+// The strings are joined with spaces into the list's source so the spans stay valid.
+static TokenList classifyTokens(const MyVector& tokens) {
+    TokenList list;
+    list.tokens.reserve(tokens.getSize());
     for (int i = 0; i < tokens.getSize(); ++i) {
-        const string& token = tokens[i];
+        if (i > 0) list.source += ' ';
+        Token token = classifyToken(tokens[i]);
+        token.offset = list.source.size();
+        if (token.kind == TokenKind::Variable) token.symbol = SymbolTable::NoSymbol;
+        list.source += tokens[i];
+        list.tokens.push_back(token);
+    }
+    return list;
+}
 
-        if (isNumber(token) || isVariable(token)) {
-            // Handle both numbers and variables (single or multi-character)
-            nodes.push(new TreeNode(token)); // Create leaf node for operand or variable.
-        }
-        else if (token == "(") {
-            ops.push(token);   // Push opening parenthesis to operator stack.
-        }
-        else if (token == ")") {
-            // Pop and process operators until an opening parenthesis is encountered.
-            while (!ops.empty() && ops.top() != "(") {
-                string op = ops.top(); // Pop the operator.
-                ops.pop();
+// Classifies a vector of string tokens once, producing the typed tokens the other stages consume.
+TokenList ExpressionTree::toTokenList(const MyVector& tokens) {
+    TokenList list = classifyTokens(tokens);
+    for (Token& token : list.tokens) {
+        if (token.kind == TokenKind::Variable) token.symbol = symbols->intern(list.text(token));
+    }
+    return list;
+}
 
-                // Pop two nodes from the node stack to serve as the children of the operator node.
-                TreeNode* right = nodes.empty() ? nullptr : nodes.top();
-                if (!nodes.empty()) nodes.pop();
+// Explicit stack for the iterative tree walks. The first entries live in an
+// inline array, so walks over shallow trees never allocate; deeper trees spill
+// to the heap instead of growing the call stack.
+template <typename T>
+class WalkStack {
+private:
+    static constexpr size_t InlineCapacity = 64;
+    T inlineItems[InlineCapacity];
+    std::vector<T> spilled;
+    size_t count = 0;
+
+public:
+    bool empty() const { return count == 0; }
+    void push(const T& item) {
+        if (count < InlineCapacity) inlineItems[count] = item;
+        else spilled.push_back(item);
+        ++count;
+    }
+    T& top() { return count <= InlineCapacity ? inlineItems[count - 1] : spilled.back(); }
+    void pop() {
+        if (count > InlineCapacity) spilled.pop_back();
+        --count;
+    }
+};
+
+// Returns every node of a tree to the arena it was made in.
+// Rotates each left child up until the node has none, then frees it and moves
+// right, so the whole tree is freed without recursion or any extra memory.
+// When tree is given, the spellings of its number nodes are dropped on the way.
+static void freeTree(NodeArena<ExpressionTree::TreeNode>& arena, ExpressionTree::TreeNode* root,
+                     ExpressionTree* tree = nullptr) {
+    while (root) {
+        if (root->left) {
+            ExpressionTree::TreeNode* left = root->left;
+            root->left = left->right;
+            left->right = root;
+            root = left;
+        } else {
+            ExpressionTree::TreeNode* right = root->right;
+            if (tree) tree->dropSpelling(root);
+            arena.destroy(root);
+            root = right;
+        }
+    }
+}
 
-                TreeNode* left = nodes.empty() ? nullptr : nodes.top();
-                if (!nodes.empty()) nodes.pop();
+// Deletes all nodes in the tree to prevent memory leaks.
+// The slots go back to the tree's arena for the next build, and the spelling text
+// no other tree uses is cut off.
+void ExpressionTree::deleteTree(TreeNode* root) {
+    freeTree(arena, root, this);
+    if (arena.size() == 0) {  // No number node points into the text any more
+        spellingText.clear();
+        spellingRegions.clear();
+    }
+}
 
-                // Create a new operator node and attach its children.
-                TreeNode* node = new TreeNode(op);   // Create a new operator node.
-                node->left = left;
-                node->right = right;
+// Variable names of one build that the symbol table does not hold yet. Their tokens get
+// provisional ids, and the names are interned only once the tree is built, so a failed
+// build leaves the table as it was. Names the table holds get their real ids at once.
+class PendingNames {
+    static constexpr uint32_t FirstId = 0x80000000u;  // Provisional ids count up from here
+
+    SymbolTable& symbols;
+    std::vector<std::string_view> names;  // New names in order of first use, pointing into the tokens' source
+    std::unordered_map<std::string_view, uint32_t> ids;
+public:
+    // Constructor : Gives every variable token of tokens an id; the tokens must outlive commit
+    PendingNames(SymbolTable& table, TokenList& tokens) : symbols(table) {
+        for (Token& token : tokens.tokens) {
+            if (token.kind != TokenKind::Variable) continue;
+            const std::string_view name = tokens.text(token);
+            token.symbol = symbols.find(name);
+            if (token.symbol != SymbolTable::NoSymbol) continue;
+            auto entry = ids.emplace(name, FirstId + static_cast<uint32_t>(names.size()));
+            if (entry.second) names.push_back(name);
+            token.symbol = entry.first->second;
+        }
+    }
 
-                // Push the resulting subtree back onto the nodes stack.
-                nodes.push(node);
+    // Interns the new names, in the order the serial lexer would have, and gives the
+    // variable nodes of root their real ids. Does nothing without a tree.
+    void commit(ExpressionTree::TreeNode* root) {
+        if (!root || names.empty()) return;
+        std::vector<uint32_t> real(names.size());
+        for (size_t k = 0; k < names.size(); ++k) real[k] = symbols.intern(names[k]);
+        WalkStack<ExpressionTree::TreeNode*> stack;
+        stack.push(root);
+        while (!stack.empty()) {
+            ExpressionTree::TreeNode* node = stack.top();
+            stack.pop();
+            if (node->kind == TokenKind::Variable && node->symbol >= FirstId && node->symbol - FirstId < real.size()) {
+                node->symbol = real[node->symbol - FirstId];
             }
-            if (!ops.empty()) ops.pop(); // Remove "("
+            if (node->right) stack.push(node->right);
+            if (node->left) stack.push(node->left);
         }
-        else if (isOperator(token)) {
-            // If the token is an operator, handle precedence and associativity.
-            while (!ops.empty() && ops.top() != "(" &&
-                   (precedence(ops.top()) > precedence(token) ||
-                    (precedence(ops.top()) == precedence(token) && token != "^"))) {
-                string op = ops.top();
-                ops.pop();
+    }
+};
+
+// Returns the number of levels of a tree (0 for an empty one).
+static int treeHeight(const ExpressionTree::TreeNode* root) {
+    int height = 0;
+    WalkStack<std::pair<const ExpressionTree::TreeNode*, int>> stack;
+    if (root) stack.push({root, 1});
+    while (!stack.empty()) {
+        std::pair<const ExpressionTree::TreeNode*, int> entry = stack.top();
+        stack.pop();
+        height = std::max(height, entry.second);
+        if (entry.first->right) stack.push({entry.first->right, entry.second + 1});
+        if (entry.first->left) stack.push({entry.first->left, entry.second + 1});
+    }
+    return height;
+}
+
+// Appends the top levels of the subtree at node in van Emde Boas order: the upper half
+// of the levels as one block, then each subtree hanging below it as a block of its own,
+// recursively. A walk of any path then touches O(log levels) blocks. Only the number of
+// levels is split, so the recursion is O(log levels) deep however deep the tree is.
+static void appendVanEmdeBoas(const ExpressionTree::TreeNode* node, int levels,
+                              std::vector<const ExpressionTree::TreeNode*>& order) {
+    if (levels == 1) {
+        order.push_back(node);
+        return;
+    }
+    const int topLevels = levels / 2;
+    appendVanEmdeBoas(node, topLevels, order);
+
+    // Roots of the bottom subtrees, left to right.
+    std::vector<const ExpressionTree::TreeNode*> bottoms;
+    WalkStack<std::pair<const ExpressionTree::TreeNode*, int>> stack;
+    stack.push({node, 0});
+    while (!stack.empty()) {
+        std::pair<const ExpressionTree::TreeNode*, int> entry = stack.top();
+        stack.pop();
+        if (entry.second == topLevels) {
+            bottoms.push_back(entry.first);
+            continue;
+        }
+        if (entry.first->right) stack.push({entry.first->right, entry.second + 1});
+        if (entry.first->left) stack.push({entry.first->left, entry.second + 1});
+    }
+    for (const ExpressionTree::TreeNode* bottom : bottoms) appendVanEmdeBoas(bottom, levels - topLevels, order);
+}
+
+// Copies a tree into one contiguous run of arena, in the given order, leaving the original alone.
+// In depth-first order every left child directly follows its parent.
+ExpressionTree::TreeNode* ExpressionTree::copyWithLayout(NodeArena<TreeNode>& arena, const TreeNode* root,
+                                                         TreeLayout layout) {
+    if (!root) return nullptr;
+    std::vector<const TreeNode*> order;
+    if (layout == TreeLayout::VanEmdeBoas) {
+        appendVanEmdeBoas(root, treeHeight(root), order);
+    } else {
+        WalkStack<const TreeNode*> stack;
+        stack.push(root);
+        while (!stack.empty()) {
+            const TreeNode* node = stack.top();
+            stack.pop();
+            order.push_back(node);
+            if (node->right) stack.push(node->right);
+            if (node->left) stack.push(node->left);
+        }
+    }
 
-                // Pop two nodes from the node stack to serve as the children of the operator node.
-                TreeNode* right = nodes.empty() ? nullptr : nodes.top();
-                if (!nodes.empty()) nodes.pop();
+    std::unordered_map<const TreeNode*, size_t> position;  // Index of each node in the run
+    position.reserve(order.size());
+    for (size_t i = 0; i < order.size(); ++i) position[order[i]] = i;
 
-                TreeNode* left = nodes.empty() ? nullptr : nodes.top();
-                if (!nodes.empty()) nodes.pop();
+    TreeNode* nodes = arena.createRun(order.size(), [&](size_t i) { return *order[i]; });
+    for (size_t i = 0; i < order.size(); ++i) {
+        nodes[i].left = order[i]->left ? nodes + position[order[i]->left] : nullptr;
+        nodes[i].right = order[i]->right ? nodes + position[order[i]->right] : nullptr;
+    }
+    return nodes;
+}
 
-                // Create a new operator node and attach its children.
-                TreeNode* node = new TreeNode(op);
-                node->left = left;
-                node->right = right;
+// Moves a tree built by this tree into one contiguous run of its arena and frees the
+// scattered original, whose slots are reused by later builds (or, if it was itself a
+// run, whose block is freed). Returns the new tree; walks over it then read memory front to back.
+ExpressionTree::TreeHandle ExpressionTree::relayout(TreeHandle root, TreeLayout layout) {
+    TreeNode* copy = copyWithLayout(arena, root.get(), layout);
+    freeTree(arena, root.release());  // The copy's number nodes take over the spellings
+    return own(copy);
+}
+
+// Binding powers used by the infix parser. An operator is shifted while its left
+// power is at least the right power of the operator waiting on the stack.
+// Left-associative operators bind one step tighter on the right; '^' does not, so it groups to the right.
+static int leftBindingPower(OpCode op) {
+    return 2 * ExpressionTree::precedence(op);
+}
+static int rightBindingPower(OpCode op) {
+    return op == OpCode::Power ? leftBindingPower(op) : leftBindingPower(op) + 1;
+}
 
-                nodes.push(node);
+// One pending level of the infix parser: an operator with its left operand, or an open parenthesis.
+struct InfixFrame {
+    ExpressionTree::TreeNode* left;  // Left operand of the operator (null for a parenthesis)
+    int index;                       // Token index of the operator or parenthesis
+    int minPower;                    // Weakest operator that may be shifted on top of this level
+    bool group;                      // True for an open parenthesis
+};
+
+// Pratt (precedence climbing) parser over the typed tokens in [begin, end), with
+// an explicit stack instead of recursion so deep nesting cannot overflow the call
+// stack. Valid input is parsed in one pass, building the tree as it goes. On the
+// first token that does not fit the grammar the partial tree is freed and null is
+// returned. operatorCount receives the number of operators shifted. When owners is
+// given, owners[i] is set to the node token i became; both parentheses of a group
+// get the root of the group.
+static ExpressionTree::TreeNode* prattParse(NodeArena<ExpressionTree::TreeNode>& arena, uint64_t textShift,
+                                           const TokenList& tokens, int begin, int end,
+                                           int& operatorCount,
+                                           std::vector<ExpressionTree::TreeNode*>* owners = nullptr) {
+    using TreeNode = ExpressionTree::TreeNode;
+    std::vector<InfixFrame> frames;
+    TreeNode* operand = nullptr;  // Completed operand waiting for an operator
+    operatorCount = 0;
+
+    // Frees the partial tree unless the whole range is parsed: on a syntax error, and
+    // when an exception such as std::bad_alloc leaves the loop.
+    struct PartialTree {
+        NodeArena<TreeNode>& arena;
+        TreeNode*& operand;
+        std::vector<InfixFrame>& frames;
+        bool finished;
+        ~PartialTree() {
+            if (finished) return;
+            freeTree(arena, operand);
+            for (const InfixFrame& frame : frames) freeTree(arena, frame.left);
+        }
+    } partial{arena, operand, frames, false};
+    int i = begin;
+
+    while (true) {
+        // Expecting an operand: open parentheses, then a number or variable.
+        while (i < end && tokens[i].kind == TokenKind::LeftParen) {
+            frames.push_back({nullptr, i, 0, true});
+            ++i;
+        }
+        if (i == end || (tokens[i].kind != TokenKind::Number && tokens[i].kind != TokenKind::Variable)) break;
+        operand = arena.create(tokens[i], textShift);
+        if (owners) (*owners)[i] = operand;
+        ++i;
+
+        // Have an operand: close finished operators and parentheses until the next operator can be shifted.
+        while (true) {
+            int minPower = frames.empty() ? 0 : frames.back().minPower;
+            if (i < end && tokens[i].kind == TokenKind::Operator &&
+                leftBindingPower(tokens[i].op) >= minPower) {
+                frames.push_back({operand, i, rightBindingPower(tokens[i].op), false});
+                operand = nullptr;
+                ++operatorCount;
+                ++i;
+                break;
             }
-            // Push the current operator onto the operator stack.
-            ops.push(token); // Push the current operator.
+            if (!frames.empty() && !frames.back().group) {
+                const Token& opToken = tokens[frames.back().index];
+                TreeNode* node = arena.create(opToken, textShift);
+                if (owners) (*owners)[frames.back().index] = node;
+                node->left = frames.back().left;
+                node->right = operand;
+                operand = node;
+                frames.pop_back();
+                continue;
+            }
+            if (!frames.empty() && i < end && tokens[i].kind == TokenKind::RightParen) {
+                if (owners) (*owners)[frames.back().index] = (*owners)[i] = operand;
+                frames.pop_back();  // Matching "(" of this group
+                ++i;
+                continue;
+            }
+            if (frames.empty() && i == end) {
+                partial.finished = true;
+                return operand;  // Whole range consumed
+            }
+            // Anything else is a syntax error.
+            i = end + 1;
+            break;
         }
+        if (i > end) break;
     }
 
-    // Process any remaining operators in the stack.
-    while (!ops.empty()) {
-        string op = ops.top(); // Pop the operator.
-        ops.pop();
+    return nullptr;  // Syntax error: the partial tree is freed on the way out
+}
 
-        // Pop two nodes from the node stack to serve as the children of the operator node.
-        TreeNode* right = nodes.empty() ? nullptr : nodes.top();
-        if (!nodes.empty()) nodes.pop();
+// Parses the infix tokens in [begin, end), returning null on a syntax error.
+// When owners is given (sized like the token list) it receives the node of every token.
+ExpressionTree::TreeNode* ExpressionTree::parseInfixRange(const TokenList& tokens, int begin, int end,
+                                                          std::vector<TreeNode*>* owners) {
+    int operatorCount = 0;
+    BuildSpellings spellings(*this, tokens, begin, end);
+    return spellings.keep(prattParse(arena, spellings.shift, tokens, begin, end, operatorCount, owners));
+}
 
-        TreeNode* left = nodes.empty() ? nullptr : nodes.top();
-        if (!nodes.empty()) nodes.pop();
+// Parses a whole infix token list. On a syntax error the usual validators
+// are run to report exactly the error they always reported.
+static ExpressionTree::TreeNode* parseInfix(ExpressionTree& tree, const TokenList& tokens, bool checkType) {
+    int operatorCount = 0;
+    BuildSpellings spellings(tree, tokens, 0, tokens.getSize());
+    ExpressionTree::TreeNode* root = prattParse(tree.arena, spellings.shift, tokens, 0, tokens.getSize(), operatorCount);
+    if (root) {
+        if (checkType && operatorCount == 0) {
+            tree.deleteTree(root);
+            throw std::runtime_error("Unable to determine expression type");
+        }
+        return spellings.keep(root);
+    }
+    if (checkType) tree.validateExpressionType(tokens, 1);
+    tree.validateExpressionStructure(tokens);
+    throw std::runtime_error("Invalid infix expression");
+}
 
-        // Create a new operator node and attach its children.
-        TreeNode* node = new TreeNode(op);
-        node->left = left;
-        node->right = right;
+// Tree building functions
+// Builds an expression tree from an infix expression.
+// Tokenizes the input and hands the tokens to the single-pass infix parser.
+// New variable names are interned only if the tree is built.
+ExpressionTree::TreeHandle ExpressionTree::buildTreeFromInfix(const std::string& infix) {
+    TokenList tokens;
+    lexTokens(infix, tokens, nullptr); // Tokenize the infix expression.
+    PendingNames names(*symbols, tokens);
+    // simple Validation for the structure of the infix expression
+    if (tokens.getSize() < 3) {
+        throw std::runtime_error("Incomplete expression: Not enough operands");
+    }
+    TreeHandle root = own(parseInfix(*this, tokens, false));
+    names.commit(root.get());
+    return root;
+}
 
-        // Push the resulting subtree back onto the nodes stack.
-        nodes.push(node);
+// Builds an expression tree from pre-tokenized infix input in a single pass.
+// Type detection, structural validation and tree construction are fused: the
+// input must be a non-empty infix expression with at least one operator, and
+// every error validateExpressionType and validateExpressionStructure report is reported.
+ExpressionTree::TreeHandle ExpressionTree::buildTreeFromInfix(const TokenList& tokens) {
+    if (tokens.getSize() < 1) {
+        throw std::runtime_error("Empty expression. Enter an expression made of numbers, variables, operators, and parentheses");
+    }
+    // The same first/last token rules determineExpressionType applies.
+    if (tokens[0].kind == TokenKind::Operator) {
+        throw std::runtime_error("Incorrect expression type. Expected Infix, but got Prefix expression.");
+    }
+    if (tokens[tokens.getSize() - 1].kind == TokenKind::Operator) {
+        throw std::runtime_error("Incorrect expression type. Expected Infix, but got Postfix expression.");
     }
+    return own(parseInfix(*this, tokens, true));
+}
 
-    // The remaining node on the nodes stack is the root of the expression tree.
-    return nodes.empty() ? nullptr : nodes.top();
+// Builds an expression tree from a prefix expression given as string tokens.
+// New variable names are interned only if the tree is built.
+ExpressionTree::TreeHandle ExpressionTree::buildTreeFromPrefix(const MyVector& tokens) {
+    TokenList list = classifyTokens(tokens);
+    PendingNames names(*symbols, list);
+    TreeHandle root = buildTreeFromPrefix(list);
+    names.commit(root.get());
+    return root;
 }
 
-// Builds an expression tree from a prefix expression.
-// Processes tokens from right to left, using a stack to construct the tree.
-ExpressionTree::TreeNode* ExpressionTree::buildTreeFromPrefix(const MyVector& tokens) {
-    validatePrefixExpressionStructure(tokens);  // Validate prefix structure.
-    MyStack<TreeNode*> nodeStack;  // Stack for nodes
-
-    // Traverse the tokens in reverse order.
-    for (int i = tokens.getSize() - 1; i >= 0; --i) {
-        const string& token = tokens[i];
-
-        // Handle negative numbers as single tokens
-        if (isNumber(token)) {
-            nodeStack.push(new TreeNode(token));  // Push operands directly.
-        }
-        else if (isOperator(token)) {
-            TreeNode* node = new TreeNode(token);  // Create an operator node.
-            // Attach the top two nodes from the stack as children.
-            if (!nodeStack.empty()) {
-                node->left = nodeStack.top();
-                nodeStack.pop();
+// Returns true if the token can stand where an operand is expected.
+static bool isOperand(const Token& token) {
+    return token.kind == TokenKind::Number || token.kind == TokenKind::Variable;
+}
+
+// Frees the subtrees left on a builder's stack when the input turns out to be malformed.
+static void deletePending(ExpressionTree& tree, std::vector<ExpressionTree::TreeNode*>& pending) {
+    for (ExpressionTree::TreeNode* node : pending) tree.deleteTree(node);
+    pending.clear();
+}
+
+// Records a problem found at token index (or -1 for the whole expression).
+static void report(std::vector<Diagnostic>& diagnostics, DiagnosticCode code, const TokenList& tokens, int index,
+                   std::string message) {
+    uint64_t offset = index >= 0 ? tokens[index].offset : 0;
+    diagnostics.push_back({code, index, offset, std::move(message)});
+}
+
+// Validates and, when tree is given, builds a prefix (read right to left) or postfix
+// (read left to right) expression in one pass. Operator arity is checked against the
+// depth of the subtree stack, or of a plain counter once building has stopped.
+// Every problem is reported; building stops at the first one, and null is returned
+// unless the input was valid.
+static ExpressionTree::TreeNode* buildPolish(ExpressionTree* tree, const TokenList& tokens, bool prefix,
+                                             std::vector<Diagnostic>& diagnostics) {
+    using TreeNode = ExpressionTree::TreeNode;
+    const std::string notation = prefix ? "prefix" : "postfix";
+    std::vector<TreeNode*> nodeStack;  // Completed subtrees waiting for a parent
+    long long operandCount = 0;        // Values available to the next operator
+    bool building = tree != nullptr;
+    const size_t firstDiagnostic = diagnostics.size();
+    std::optional<BuildSpellings> spellings;  // Text of the number nodes, kept only if the tree is built
+    if (building) spellings.emplace(*tree, tokens, 0, tokens.getSize());
+
+    // Frees the stacked subtrees if an exception such as std::bad_alloc leaves the loop.
+    struct PendingTrees {
+        ExpressionTree* tree;
+        std::vector<TreeNode*>& nodes;
+        ~PendingTrees() {
+            if (tree) deletePending(*tree, nodes);
+        }
+    } pending{tree, nodeStack};
+
+    auto stopBuilding = [&]() {
+        if (building) deletePending(*tree, nodeStack);
+        building = false;
+    };
+
+    const int size = tokens.getSize();
+    for (int step = 0; step < size; ++step) {
+        const int i = prefix ? size - 1 - step : step;
+        const Token& token = tokens[i];
+
+        if (isOperand(token)) {
+            ++operandCount;
+            if (building) nodeStack.push_back(tree->arena.create(token, spellings->shift));
+        } else if (token.kind == TokenKind::Operator) {
+            if (operandCount < 2) {
+                report(diagnostics, DiagnosticCode::InsufficientOperands, tokens, i,
+                       std::string(prefix ? "Prefix" : "Postfix") + " validation error: Insufficient operands for operator '" +
+                       std::string(tokens.text(token)) + "'");
+                stopBuilding();
+                operandCount = 1;  // Carry on as if the operator had produced a value
+                continue;
             }
-            if (!nodeStack.empty()) {
-                node->right = nodeStack.top();
-                nodeStack.pop();
+            --operandCount;
+            if (building) {
+                // Attach the top two nodes from the stack as children.
+                TreeNode* node = tree->arena.create(token, spellings->shift);
+                TreeNode* first = nodeStack.back();
+                nodeStack.pop_back();
+                (prefix ? node->left : node->right) = first;
+                (prefix ? node->right : node->left) = nodeStack.back();
+                nodeStack.back() = node;
             }
-            nodeStack.push(node);  // Push the constructed node back to the stack.
         } else {
-            nodeStack.push(new TreeNode(token)); // Treat other tokens as variables.
+            report(diagnostics, DiagnosticCode::InvalidToken, tokens, i,
+                   "Invalid token in " + notation + " expression: " + std::string(tokens.text(token)));
+            stopBuilding();
         }
     }
-    return nodeStack.empty() ? nullptr : nodeStack.top();  // Return the root.
+
+    // Exactly one subtree (the whole expression) should remain.
+    if (operandCount != 1) {
+        report(diagnostics, DiagnosticCode::IncorrectOperandCount, tokens, -1,
+               "Invalid " + notation + " expression: Incorrect number of operands");
+        stopBuilding();
+    }
+    if (!building || diagnostics.size() != firstDiagnostic) return nullptr;
+    TreeNode* root = nodeStack.back();
+    nodeStack.clear();  // The tree now belongs to the caller
+    return spellings->keep(root);
 }
 
+// Builds an expression tree from a prefix expression.
+// Processes tokens from right to left, validating and building in the same pass:
+// the depth of the subtree stack is the operand count the validator keeps.
+ExpressionTree::TreeHandle ExpressionTree::buildTreeFromPrefix(const TokenList& tokens) {
+    std::vector<Diagnostic> diagnostics;
+    TreeNode* root = buildPolish(this, tokens, true, diagnostics);
+    if (!root) throw std::runtime_error(diagnostics.front().message);
+    return own(root);
+}
+
+// Builds an expression tree from a postfix expression given as string tokens.
+// New variable names are interned only if the tree is built.
+ExpressionTree::TreeHandle ExpressionTree::buildTreeFromPostfix(const MyVector& tokens) {
+    TokenList list = classifyTokens(tokens);
+    PendingNames names(*symbols, list);
+    TreeHandle root = buildTreeFromPostfix(list);
+    names.commit(root.get());
+    return root;
+}
 
 // Builds an expression tree from a postfix expression.
-// Processes tokens from left to right, using a stack to construct the tree.
-ExpressionTree::TreeNode* ExpressionTree::buildTreeFromPostfix(const MyVector& tokens) {
-    validatePostfixExpressionStructure(tokens);
-    MyStack<TreeNode*> nodeStack;  // Stack for nodes.
+// Processes tokens from left to right, validating and building in the same pass.
+ExpressionTree::TreeHandle ExpressionTree::buildTreeFromPostfix(const TokenList& tokens) {
+    std::vector<Diagnostic> diagnostics;
+    TreeNode* root = buildPolish(this, tokens, false, diagnostics);
+    if (!root) throw std::runtime_error(diagnostics.front().message);
+    return own(root);
+}
 
-    for (int i = 0; i < tokens.getSize(); ++i) {
-        const string& token = tokens[i];
+// Per-chunk state of the parallel postfix builder.
+struct PostfixChunk {
+    // Found by the scan
+    long long delta = 0;    // Change in stack depth across the chunk
+    long long need = 0;     // Subtrees the chunk takes from the stack below it
+    bool invalid = false;   // Holds a token that is neither operand nor operator
+    // Found by the build
+    std::vector<ExpressionTree::TreeNode*> outputs;  // Subtrees the chunk leaves on the stack
+    struct Patch {
+        ExpressionTree::TreeNode* node;  // Operator whose child comes from an earlier chunk
+        bool left;                       // Which child
+        long long hole;                  // Position from the top of the stack when the chunk starts
+    };
+    std::vector<Patch> patches;
+    NodeArena<ExpressionTree::TreeNode> nodes;       // Nodes of the chunk until the tree's arena adopts them
+};
+
+// Builds the tree of a very large postfix expression on a thread pool.
+// A parallel scan gives each chunk its stack-depth delta and the deepest point
+// it reaches below its starting depth; prefix sums over the deltas validate the
+// whole input without building anything. Each chunk then builds its own forest,
+// leaving holes where an operator takes a subtree from an earlier chunk, and
+// the forests are merged left to right by filling the holes. The tree is the one
+// buildTreeFromPostfix builds; invalid input is handed to it for the error message.
+ExpressionTree::TreeHandle ExpressionTree::buildTreeFromPostfixParallel(const TokenList& tokens, ThreadPool* threads) {
+    const size_t minimumParallelTokens = 1 << 16;
+    ThreadPool& pool = threads ? *threads : ThreadPool::shared();
+    const size_t size = static_cast<size_t>(tokens.getSize());
+    if (size < minimumParallelTokens || pool.size() == 1) {
+        return buildTreeFromPostfix(tokens);
+    }
 
-        // Handle negative numbers as single tokens
-        if (isNumber(token)) {
-            nodeStack.push(new TreeNode(token));   // Push operands directly.
+    size_t chunkCount = static_cast<size_t>(pool.size()) * 4;
+    std::vector<PostfixChunk> chunks(chunkCount);
+    auto chunkBegin = [&](size_t c) { return size / chunkCount * c; };
+    auto chunkEnd = [&](size_t c) { return c + 1 == chunkCount ? size : size / chunkCount * (c + 1); };
+
+    // Scan: depth delta and lowest point of every chunk.
+    pool.run(chunkCount, [&](size_t c) {
+        PostfixChunk& chunk = chunks[c];
+        long long depth = 0;
+        long long lowest = 0;
+        for (size_t i = chunkBegin(c); i < chunkEnd(c); ++i) {
+            const Token& token = tokens[static_cast<int>(i)];
+            if (isOperand(token)) {
+                ++depth;
+            } else if (token.kind == TokenKind::Operator) {
+                if (depth - 2 < lowest) lowest = depth - 2;
+                --depth;
+            } else {
+                chunk.invalid = true;
+                return;
+            }
         }
-        else if (isOperator(token)) {
-            TreeNode* node = new TreeNode(token); // Create an operator node.
+        chunk.delta = depth;
+        chunk.need = -lowest;
+    });
+
+    // Prefix sum over the deltas: no chunk may reach below the bottom of the stack.
+    long long depth = 0;
+    bool valid = true;
+    for (const PostfixChunk& chunk : chunks) {
+        if (chunk.invalid || depth < chunk.need) {
+            valid = false;
+            break;
+        }
+        depth += chunk.delta;
+    }
+    if (!valid || depth != 1) {
+        return buildTreeFromPostfix(tokens);  // Throws the serial builder's error
+    }
 
-            // Attach the top two nodes from the stack as children.
-            if (!nodeStack.empty()) {
-                node->right = nodeStack.top();
-                nodeStack.pop();
+    // Build: every chunk assembles its own forest. Null entries are holes.
+    BuildSpellings spellings(*this, tokens, 0, tokens.getSize());
+    pool.run(chunkCount, [&](size_t c) {
+        PostfixChunk& chunk = chunks[c];
+        std::vector<std::pair<TreeNode*, long long>> stack;  // Node, or null and a hole position
+        stack.reserve(static_cast<size_t>(chunk.need) + 64);
+        for (long long hole = chunk.need - 1; hole >= 0; --hole) stack.push_back({nullptr, hole});
+
+        for (size_t i = chunkBegin(c); i < chunkEnd(c); ++i) {
+            const Token& token = tokens[static_cast<int>(i)];
+            TreeNode* node = chunk.nodes.create(token, spellings.shift);
+            if (token.kind == TokenKind::Operator) {
+                std::pair<TreeNode*, long long> right = stack.back();
+                stack.pop_back();
+                std::pair<TreeNode*, long long> left = stack.back();
+                stack.pop_back();
+                if (right.first) node->right = right.first; else chunk.patches.push_back({node, false, right.second});
+                if (left.first) node->left = left.first; else chunk.patches.push_back({node, true, left.second});
             }
-            if (!nodeStack.empty()) {
-                node->left = nodeStack.top();
-                nodeStack.pop();
+            stack.push_back({node, 0});
+        }
+        // Every hole has been used: the chunk reached exactly need below its start.
+        chunk.outputs.reserve(stack.size());
+        for (const std::pair<TreeNode*, long long>& entry : stack) chunk.outputs.push_back(entry.first);
+    });
+
+    // Merge: fill each chunk's holes from the stack the earlier chunks left.
+    // The nodes join the tree's arena in one step at the end, so if anything throws
+    // before then the chunk arenas free them on the way out.
+    NodeArena<TreeNode> built;
+    std::vector<TreeNode*> stack;
+    for (PostfixChunk& chunk : chunks) {
+        built.adopt(chunk.nodes);
+        for (const PostfixChunk::Patch& patch : chunk.patches) {
+            TreeNode* child = stack[stack.size() - 1 - static_cast<size_t>(patch.hole)];
+            if (patch.left) patch.node->left = child; else patch.node->right = child;
+        }
+        stack.resize(stack.size() - static_cast<size_t>(chunk.need));
+        stack.insert(stack.end(), chunk.outputs.begin(), chunk.outputs.end());
+    }
+    arena.adopt(built);
+    return own(spellings.keep(stack.back()));
+}
+
+// Per-chunk summary of the validating scan of the parallel infix parser.
+struct InfixChunk {
+    long long operands = 0;   // Numbers and variables
+    long long operators = 0;  // Binary operators
+    long long delta = 0;      // Change in parenthesis depth
+    long long lowest = 0;     // Lowest depth relative to the chunk start
+    bool error = false;       // A check of validateExpressionStructure failed
+};
+
+// Work item of the parallel infix parser: the tree of tokens [begin, end) goes into *slot.
+struct InfixRange {
+    int begin;
+    int end;
+    ExpressionTree::TreeNode** slot;
+    int level;  // Number of splits above this range
+};
+
+// Parses a very large infix expression on a thread pool.
+// One parallel scan does the checks of validateExpressionStructure, including
+// parenthesis balance from a prefix sum over per-chunk depth deltas, and a second
+// one records the parenthesis depth of every token. A large range is then split
+// at its operators of lowest precedence at the range's own depth: those become
+// a left-leaning (or, for '^', right-leaning) spine of nodes and the operands
+// between them are parsed concurrently, small ones directly with the Pratt parser
+// and large ones split again. The tree is the one buildTreeFromInfix builds;
+// invalid input is handed to it for the error message.
+ExpressionTree::TreeHandle ExpressionTree::buildTreeFromInfixParallel(const TokenList& tokens, ThreadPool* threads) {
+    const size_t minimumParallelTokens = 1 << 16;
+    ThreadPool& pool = threads ? *threads : ThreadPool::shared();
+    const int size = tokens.getSize();
+    if (static_cast<size_t>(size) < minimumParallelTokens || pool.size() == 1) {
+        return buildTreeFromInfix(tokens);
+    }
+
+    const int chunkCount = static_cast<int>(pool.size()) * 4;
+    auto chunkBegin = [&](int c) { return static_cast<int>(static_cast<long long>(size) * c / chunkCount); };
+
+    // Scan: the local checks of validateExpressionStructure and per-chunk counts.
+    std::vector<InfixChunk> chunks(chunkCount);
+    pool.run(chunkCount, [&](size_t c) {
+        InfixChunk& chunk = chunks[c];
+        for (int i = chunkBegin(static_cast<int>(c)); i < chunkBegin(static_cast<int>(c) + 1); ++i) {
+            const Token& token = tokens[i];
+            const Token* previous = i > 0 ? &tokens[i - 1] : nullptr;
+            switch (token.kind) {
+                case TokenKind::LeftParen:
+                    if (previous && (isOperand(*previous) || previous->kind == TokenKind::RightParen)) chunk.error = true;
+                    ++chunk.delta;
+                    break;
+                case TokenKind::RightParen:
+                    if (--chunk.delta < chunk.lowest) chunk.lowest = chunk.delta;
+                    break;
+                case TokenKind::Operator:
+                    ++chunk.operators;
+                    if (i == 0 || i == size - 1 || previous->kind == TokenKind::Operator) chunk.error = true;
+                    break;
+                case TokenKind::Number:
+                case TokenKind::Variable:
+                    ++chunk.operands;
+                    if (previous && (isOperand(*previous) || previous->kind == TokenKind::RightParen)) chunk.error = true;
+                    break;
+                case TokenKind::Invalid:
+                    chunk.error = true;
+                    break;
             }
-            nodeStack.push(node);  // Push the constructed node back to the stack.
-        } else {
-            nodeStack.push(new TreeNode(token));  // Treat other tokens as variables
+            if (chunk.error) return;
         }
+    });
+
+    // Prefix sum over the depth deltas validates the parentheses.
+    std::vector<long long> startDepth(chunkCount + 1, 0);
+    long long operands = 0;
+    long long operators = 0;
+    bool valid = true;
+    for (int c = 0; c < chunkCount; ++c) {
+        const InfixChunk& chunk = chunks[c];
+        if (chunk.error || startDepth[c] + chunk.lowest < 0) valid = false;
+        startDepth[c + 1] = startDepth[c] + chunk.delta;
+        operands += chunk.operands;
+        operators += chunk.operators;
+    }
+    if (!valid || startDepth[chunkCount] != 0 || operands <= operators || operators == 0) {
+        return buildTreeFromInfix(tokens);  // Throws the serial parser's error
     }
-    return nodeStack.empty() ? nullptr : nodeStack.top(); // Return the root.
+
+    // Depth of every token: parentheses get the depth outside their group.
+    std::vector<int> depth(size);
+    pool.run(chunkCount, [&](size_t c) {
+        int d = static_cast<int>(startDepth[c]);
+        for (int i = chunkBegin(static_cast<int>(c)); i < chunkBegin(static_cast<int>(c) + 1); ++i) {
+            if (tokens[i].kind == TokenKind::LeftParen) depth[i] = d++;
+            else if (tokens[i].kind == TokenKind::RightParen) depth[i] = --d;
+            else depth[i] = d;
+        }
+    });
+
+    const int grain = std::max(4096, size / static_cast<int>(pool.size() * 16));
+    const int maximumLevel = 16;    // Deeper splits fall back to the Pratt parser
+    const int pieceCount = static_cast<int>(pool.size()) * 4;
+    TreeNode* root = nullptr;
+    std::vector<InfixRange> frontier = {{0, size, &root, 0}};
+    NodeArena<TreeNode> built;  // Every node made so far; joins the tree's arena only once the tree is whole
+    BuildSpellings spellings(*this, tokens, 0, size);
+
+    while (!frontier.empty()) {
+        std::vector<InfixRange> next;
+        for (const InfixRange& range : frontier) {
+            int begin = range.begin;
+            int end = range.end;
+            int count = 0;
+            int lowestPrecedence = 0;
+            std::vector<int> counts(pieceCount);
+            auto pieceBegin = [&](int p) { return begin + static_cast<int>(static_cast<long long>(end - begin) * p / pieceCount); };
+
+            // Find the weakest operators outside any parentheses of the range, stripping
+            // parentheses that wrap the whole range.
+            for (int strips = 0; ; ++strips) {
+                if (end - begin < grain || range.level >= maximumLevel || strips >= 4) break;
+                int base = depth[begin];
+                std::vector<int> lowest(pieceCount, 0);
+                pool.run(pieceCount, [&](size_t p) {
+                    int weakest = 0;
+                    for (int i = pieceBegin(static_cast<int>(p)); i < pieceBegin(static_cast<int>(p) + 1); ++i) {
+                        if (tokens[i].kind == TokenKind::Operator && depth[i] == base) {
+                            int precedence = ExpressionTree::precedence(tokens[i].op);
+                            if (weakest == 0 || precedence < weakest) weakest = precedence;
+                        }
+                    }
+                    lowest[p] = weakest;
+                });
+                for (int weakest : lowest) {
+                    if (weakest != 0 && (lowestPrecedence == 0 || weakest < lowestPrecedence)) lowestPrecedence = weakest;
+                }
+                if (lowestPrecedence != 0) break;
+                ++begin;  // "( ... )": parse the inside
+                --end;
+            }
+            if (lowestPrecedence == 0) {
+                int operatorCount = 0;
+                *range.slot = prattParse(built, spellings.shift, tokens, begin, end, operatorCount);
+                continue;
+            }
+
+            // Positions of the split operators, gathered in order via a prefix sum over the pieces.
+            int base = depth[begin];
+            auto isSplit = [&](int i) {
+                return tokens[i].kind == TokenKind::Operator && depth[i] == base &&
+                       ExpressionTree::precedence(tokens[i].op) == lowestPrecedence;
+            };
+            pool.run(pieceCount, [&](size_t p) {
+                int found = 0;
+                for (int i = pieceBegin(static_cast<int>(p)); i < pieceBegin(static_cast<int>(p) + 1); ++i) {
+                    if (isSplit(i)) ++found;
+                }
+                counts[p] = found;
+            });
+            std::vector<int> offsets(pieceCount + 1, 0);
+            for (int p = 0; p < pieceCount; ++p) offsets[p + 1] = offsets[p] + counts[p];
+            count = offsets[pieceCount];
+            std::vector<int> splits(count);
+            std::vector<TreeNode*> spine(count);
+            std::vector<NodeArena<TreeNode>> pieceNodes(pieceCount);  // One arena per task, adopted below
+            pool.run(pieceCount, [&](size_t p) {
+                int k = offsets[p];
+                for (int i = pieceBegin(static_cast<int>(p)); i < pieceBegin(static_cast<int>(p) + 1); ++i) {
+                    if (isSplit(i)) {
+                        splits[k] = i;
+                        spine[k] = pieceNodes[p].create(tokens[i], spellings.shift);
+                        ++k;
+                    }
+                }
+            });
+
+            // Link the spine and parse the operands between the split operators.
+            // Left-associative operators fold to the left; '^' folds to the right.
+            bool rightFold = lowestPrecedence == ExpressionTree::precedence(OpCode::Power);
+            *range.slot = rightFold ? spine.front() : spine.back();
+            const int segmentCount = count + 1;
+            const int batchCount = std::min(segmentCount, static_cast<int>(pool.size()) * 8);
+            std::vector<std::vector<InfixRange>> large(batchCount);
+            std::vector<NodeArena<TreeNode>> batchNodes(batchCount);
+            pool.run(batchCount, [&](size_t t) {
+                int first = static_cast<int>(static_cast<long long>(segmentCount) * t / batchCount);
+                int last = static_cast<int>(static_cast<long long>(segmentCount) * (t + 1) / batchCount);
+                for (int j = first; j < last; ++j) {
+                    if (j < count) {
+                        if (rightFold && j + 1 < count) spine[j]->right = spine[j + 1];
+                        if (!rightFold && j > 0) spine[j]->left = spine[j - 1];
+                    }
+                    TreeNode** slot;
+                    if (rightFold) slot = j < count ? &spine[j]->left : &spine[count - 1]->right;
+                    else slot = j == 0 ? &spine[0]->left : &spine[j - 1]->right;
+                    int segmentBegin = j == 0 ? begin : splits[j - 1] + 1;
+                    int segmentEnd = j == count ? end : splits[j];
+                    if (segmentEnd - segmentBegin >= grain) {
+                        large[t].push_back({segmentBegin, segmentEnd, slot, range.level + 1});
+                    } else {
+                        int operatorCount = 0;
+                        *slot = prattParse(batchNodes[t], spellings.shift, tokens, segmentBegin, segmentEnd, operatorCount);
+                    }
+                }
+            });
+            for (NodeArena<TreeNode>& nodes : pieceNodes) built.adopt(nodes);
+            for (NodeArena<TreeNode>& nodes : batchNodes) built.adopt(nodes);
+            for (const std::vector<InfixRange>& batch : large) next.insert(next.end(), batch.begin(), batch.end());
+        }
+        frontier.swap(next);
+    }
+    arena.adopt(built);
+    return own(spellings.keep(root));
 }
 
 // Traversal functions
 // Performs an inorder traversal of the tree to give infix expression
 // Constructs a string representation with parentheses for clarity.
+// Walks with an explicit stack and appends to one string, so no per-node strings are built.
 std::string ExpressionTree::inorder(TreeNode* root) const {
-    if (!root) return "";
-    if (isOperator(root->value)) {
-        return "( " + inorder(root->left) + " " + root->value + " " + inorder(root->right) + " )";
+    std::string result;
+    WalkStack<std::pair<const TreeNode*, int>> stack;  // Node and how much of it is written
+    stack.push({root, 0});
+    while (!stack.empty()) {
+        std::pair<const TreeNode*, int>& entry = stack.top();
+        const TreeNode* node = entry.first;
+        if (!node) {
+            stack.pop();
+        } else if (node->kind != TokenKind::Operator) {
+            result += spelling(node);
+            stack.pop();
+        } else if (entry.second == 0) {
+            result += "( ";
+            entry.second = 1;
+            stack.push({node->left, 0});
+        } else if (entry.second == 1) {
+            result += ' ';
+            result += spelling(node);
+            result += ' ';
+            entry.second = 2;
+            stack.push({node->right, 0});
+        } else {
+            result += " )";
+            stack.pop();
+        }
     }
-    return root->value;
+    return result;
 }
 
 // Performs a preorder traversal of the tree to give preorder expression
 // Constructs a string representation of the traversal.
 std::string ExpressionTree::preorder(TreeNode* root) const {
-    if (!root) return "";
-    string result = root->value;
-    string leftStr = preorder(root->left);
-    string rightStr = preorder(root->right);
-
-    if (!leftStr.empty()) result += " " + leftStr;
-    if (!rightStr.empty()) result += " " + rightStr;
+    std::string result;
+    WalkStack<const TreeNode*> stack;
+    if (root) stack.push(root);
+    while (!stack.empty()) {
+        const TreeNode* node = stack.top();
+        stack.pop();
+        if (!result.empty()) result += ' ';
+        result += spelling(node);
+        // Right is pushed first so the left subtree is written first.
+        if (node->right) stack.push(node->right);
+        if (node->left) stack.push(node->left);
+    }
     return result;
 }
 
 // Performs a postorder traversal of the tree to give postorder expression
 // Constructs a string representation of the traversal.
 std::string ExpressionTree::postorder(TreeNode* root) const {
-    if (!root) return "";
-    string result = "";
-    string leftStr = postorder(root->left);
-    string rightStr = postorder(root->right);
-
-    if (!leftStr.empty()) result += leftStr + " ";
-    if (!rightStr.empty()) result += rightStr + " ";
-    result += root->value;
+    std::string result;
+    WalkStack<std::pair<const TreeNode*, bool>> stack;  // Node and whether its children are done
+    if (root) stack.push({root, false});
+    while (!stack.empty()) {
+        std::pair<const TreeNode*, bool>& entry = stack.top();
+        const TreeNode* node = entry.first;
+        if (!entry.second) {
+            entry.second = true;
+            if (node->right) stack.push({node->right, false});
+            if (node->left) stack.push({node->left, false});
+        } else {
+            if (!result.empty()) result += ' ';
+            result += spelling(node);
+            stack.pop();
+        }
+    }
     return result;
 }
 
-// Evaluates the expression tree.
-// Recursively calculates the result using operator nodes and operand/variable values.
+// Evaluates the expression tree with values given by variable name.
+// The names are resolved to symbol ids once, then the id-based evaluation runs.
 long double ExpressionTree::evaluate(TreeNode* root, const std::unordered_map<std::string, double>& variableValues) const {
+    VariableBindings bindings;
+    for (const auto& entry : variableValues) {
+        uint32_t id = symbols->find(entry.first);
+        if (id != SymbolTable::NoSymbol) bindings.set(id, entry.second);
+    }
+    return evaluate(root, bindings);
+}
+
+// Evaluates the expression tree.
+// Walks the tree in postorder with an explicit stack, keeping operand values on a
+// value stack, so deep trees cannot overflow the call stack. Nodes carry their kind
+// and operator code, so dispatch is a switch rather than string comparisons,
+// and variables are looked up by symbol id.
+long double ExpressionTree::evaluate(TreeNode* root, const VariableBindings& variableValues) const {
     if (!root) return 0;
-    // If the node is not an operator, evaluate as a number or variable.
-    if (!isOperator(root->value)) {
-        if (isNumber(root->value)) {
-            return stod(root->value); // Convert number strings to double
+    WalkStack<std::pair<const TreeNode*, bool>> stack;  // Node and whether its children are done
+    WalkStack<double> values;                           // Values of finished subtrees
+    stack.push({root, false});
+
+    while (!stack.empty()) {
+        std::pair<const TreeNode*, bool> entry = stack.top();
+        stack.pop();
+        const TreeNode* node = entry.first;
+        if (!node) {
+            values.push(0);  // A missing operand counts as zero
+            continue;
         }
-        if (isVariable(root->value) && variableValues.find(root->value) != variableValues.end()) {
-            return variableValues.at(root->value); // Use the value for the variable
+        // If the node is not an operator, evaluate as a number or variable.
+        if (node->kind != TokenKind::Operator) {
+            if (node->kind == TokenKind::Number) {
+                values.push(node->number); // Parsed once by the lexer, never re-read from the string
+                continue;
+            }
+            if (node->kind == TokenKind::Variable) {
+                const double* value = variableValues.find(node->symbol);
+                if (value) {
+                    values.push(*value); // Use the value for the variable
+                    continue;
+                }
+            }
+            throw std::runtime_error("Undefined variable: " + std::string(spelling(node)));
+        }
+        if (!entry.second) {
+            // Evaluate the left and then the right subtree before the operator.
+            stack.push({node, true});
+            stack.push({node->right, false});
+            stack.push({node->left, false});
+            continue;
         }
-        throw std::runtime_error("Undefined variable: " + root->value);
-    }
 
-    // Recursively evaluate the left and right subtrees.
-    double leftValue = evaluate(root->left, variableValues);
-    double rightValue = evaluate(root->right, variableValues);
+        double rightValue = values.top();
+        values.pop();
+        double leftValue = values.top();
+        values.pop();
 
-    // Perform the operation based on the operator.
-    if (root->value == "+") return leftValue + rightValue;
-    if (root->value == "-") return leftValue - rightValue;
-    if (root->value == "*") return leftValue * rightValue;
-    if (root->value == "/") {
-        if (rightValue == 0) throw std::runtime_error("Division by zero!");
-        return leftValue / rightValue;
+        // Perform the operation based on the operator.
+        double result = applyOperator(node->op, leftValue, rightValue);
+        values.push(result);
     }
-    if (root->value == "%") {
-        if (rightValue == 0) throw std::runtime_error("Modulo by zero!");
-        return fmod(leftValue, rightValue);
-    }
-    if (root->value == "^") return pow(leftValue, rightValue);
-
-    throw std::runtime_error("Invalid operator!"); // Handle unexpected operators.
+    return values.top();
 }
 
 // Tokenizes an expression into a vector of strings representing numbers, operators, and parentheses.
 // Handles negative numbers, multi-character variables, and various delimiters.
-// Input Format: The expression must be entered with leaving spaces between numbers/varaibles/parenthesis
+// The Lexer walks the input once and hands back views into it; only the copy into
+// the result vector allocates. Large inputs are indexed first so whitespace is skipped in bulk.
+// Input Format: Spaces between tokens are optional, so "A+B*(C-D)" and "A + B * ( C - D )" give the same tokens
 MyVector ExpressionTree::tokenize(const std::string& expression) const {
     MyVector tokens;  // Vector to store tokens.
-    istringstream iss(expression); // String stream for processing the expression.
-    string token;
-
-    // Process each space-separated segment of the input expression.
-    while (iss >> token) {
-        // If token is just a minus sign, it's an operator
-        if (token == "-") {
-            tokens.push_back(token); // Add the minus sign as an operator.
-            continue;
-        }
+    StructuralIndex index;
+    bool indexed = expression.size() >= StructuralIndex::MinimumInputSize && index.build(expression);
+    Lexer lexer(expression, nullptr, indexed ? &index : nullptr);
+    std::string_view token;
+
+    // Collect every token the lexer recognises.
+    while (lexer.next(token)) {
+        tokens.push_back(std::string(token));
+    }
+    return tokens; // Return the vector of the tokens
+}
 
-        // Check if it's a negative number (starts with minus and has more characters)
-        if (token[0] == '-' && token.length() > 1) {
-            // Verify the rest is a valid number
-            bool isValidNumber = true;
-            bool hasDecimal = false;
-            for (size_t i = 1; i < token.length(); i++) {
-                if (token[i] == '.') {
-                    // Only one decimal point is allowed.
-                    if (hasDecimal) {
-                        isValidNumber = false;
-                        break;
-                    }
-                    hasDecimal = true;
-                } else if (!isdigit(token[i])) {
-                    // If a non-digit character is found, the token is invalid.
-                    isValidNumber = false;
-                    break;
-                }
-            }
-            if (isValidNumber) {
-                tokens.push_back(token);  // Add as a single negative number token
-                continue;
-            }
-        }
+// Tokenizes an expression into typed tokens.
+// Each token is classified once here (kind, operator code, parsed number, interned
+// variable id and source span) so no later stage needs to look at its characters.
+void ExpressionTree::tokenize(std::string_view expression, TokenList& tokens) {
+    lexTokens(expression, tokens, symbols);
+}
 
-        // Handle other operators
-        if (isOperator(token)) {
-            tokens.push_back(token);
-            continue;
-        }
+// Tokenizes a very large expression on all cores.
+// The input is cut at safe boundaries, each chunk is lexed into its own buffer
+// with its own symbol table, and the buffers are stitched together at offsets
+// given by a prefix sum over the chunk token counts. Names are merged into the
+// shared table in chunk order, so ids come out exactly as the serial pass gives them.
+void ExpressionTree::tokenizeParallel(std::string_view expression, TokenList& tokens, ThreadPool* threads) {
+    const size_t minimumParallelSize = 1 << 20;
+    ThreadPool& pool = threads ? *threads : ThreadPool::shared();
+    if (expression.size() < minimumParallelSize || pool.size() == 1) {
+        tokenize(expression, tokens);
+        return;
+    }
 
-        // Handle parentheses (opening or closing).
-        if (token == "(" || token == ")") {
-            tokens.push_back(token);
-            continue;
-        }
+    tokens.source.assign(expression.data(), expression.size());
+    tokens.tokens.clear();
+    std::string_view text(tokens.source);
+
+    // Nominal chunk boundaries, each moved forward to the next safe split.
+    size_t chunkCount = static_cast<size_t>(pool.size()) * 4;
+    std::vector<size_t> bounds(chunkCount + 1);
+    bounds[0] = 0;
+    bounds[chunkCount] = text.size();
+    pool.run(chunkCount - 1, [&](size_t i) {
+        size_t position = text.size() / chunkCount * (i + 1);
+        while (position < text.size() && !Lexer::isRestartPoint(text, position)) ++position;
+        bounds[i + 1] = position;
+    });
+    for (size_t i = 1; i < chunkCount; ++i) {
+        if (bounds[i] < bounds[i - 1]) bounds[i] = bounds[i - 1];
+    }
 
-        // Handle regular numbers and variables
-        if (isNumber(token) || (token.length() == 1 && isalpha(token[0]))) {
-            tokens.push_back(token);
-            continue;
+    // Lex every chunk independently.
+    std::vector<std::vector<Token>> chunkTokens(chunkCount);
+    std::vector<std::unique_ptr<SymbolTable>> chunkSymbols(chunkCount);
+    pool.run(chunkCount, [&](size_t i) {
+        std::string_view chunk = text.substr(bounds[i], bounds[i + 1] - bounds[i]);
+        chunkSymbols[i].reset(new SymbolTable);
+        StructuralIndex index;
+        bool indexed = chunk.size() >= StructuralIndex::MinimumInputSize && index.build(chunk);
+        Lexer lexer(chunk, chunkSymbols[i].get(), indexed ? &index : nullptr);
+        Token token;
+        while (lexer.next(token)) {
+            token.offset += bounds[i];
+            chunkTokens[i].push_back(token);
         }
-
-        // If we get here, it might be a multi-character variable, so validate it.
-        bool isVariable = true;
-        for (char c : token) {
-            if (!isalnum(c)) {
-                isVariable = false;
-                break;
-            }
+    });
+
+    // Map local ids to shared ids in order of first appearance.
+    std::vector<std::vector<uint32_t>> idMaps(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        const SymbolTable& local = *chunkSymbols[i];
+        idMaps[i].resize(local.size());
+        for (uint32_t id = 0; id < local.size(); ++id) {
+            idMaps[i][id] = symbols->intern(local.name(id));
         }
+    }
 
-        // If the token is a valid multi-character variable, add it to the vector.
-        if (isVariable) {
-            tokens.push_back(token);
+    // Prefix sum over token counts gives each chunk its place in the output.
+    std::vector<size_t> starts(chunkCount + 1, 0);
+    for (size_t i = 0; i < chunkCount; ++i) starts[i + 1] = starts[i] + chunkTokens[i].size();
+    tokens.tokens.resize(starts[chunkCount]);
+    pool.run(chunkCount, [&](size_t i) {
+        Token* out = tokens.tokens.data() + starts[i];
+        for (const Token& token : chunkTokens[i]) {
+            *out = token;
+            if (token.kind == TokenKind::Variable) out->symbol = idMaps[i][token.symbol];
+            ++out;
         }
-
-    }
-    return tokens; // Return the vector of the tokens
+        std::vector<Token>().swap(chunkTokens[i]);
+    });
 }
 
-// Validates the structure of an infix expression.
-// Checks for balanced parentheses, proper operator placement, and overall syntax correctness.
+// Validates the structure of an infix expression given as string tokens.
 void ExpressionTree::validateExpressionStructure(const MyVector& tokens) {
-    int operandCount = 0;        // Tracks the number of operands (numbers or variables).
-    int operatorCount = 0;       // Tracks the number of operators.
-    int parenthesesBalance = 0;  // Tracks the balance of parentheses.
+    validateExpressionStructure(classifyTokens(tokens));
+}
+
+// Checks the structure of an infix expression and reports every problem:
+// balanced parentheses, proper operator placement, and overall syntax correctness.
+static void diagnoseInfix(const TokenList& tokens, std::vector<Diagnostic>& diagnostics) {
+    long long operandCount = 0;   // Tracks the number of operands (numbers or variables).
+    long long operatorCount = 0;  // Tracks the number of operators.
+    std::vector<int> open;        // Indices of the parentheses still open.
 
     // Iterate through the tokens to analyze the structure.
     for (int i = 0; i < tokens.getSize(); ++i) {
-        const string& token = tokens[i];
-
-        // Check for opening parentheses.
-        if (token == "(") {
-            parenthesesBalance++;  // Increment balance for an opening parenthesis.
-
-            // Ensure that an operator precedes an opening parenthesis (if applicable).
-            if (i > 0 && (isNumber(tokens[i-1]) || isVariable(tokens[i-1]) || tokens[i-1] == ")")) {
-                throw std::runtime_error("Invalid syntax: Missing operator before opening parenthesis");
-            }
-        }
-        // Check for closing parentheses.
-        else if (token == ")") {
-            parenthesesBalance--; // Decrement balance for a closing parenthesis.
-
-            // Detect unmatched closing parentheses (more closing than opening).
-            if (parenthesesBalance < 0) {
-                throw std::runtime_error("Unbalanced parentheses: Too many closing parentheses");
-            }
-        }
-        // Check for operators.
-        else if (isOperator(token)) {
-            operatorCount++;  // Increment operator count.
-            // Check if operator is at the start or end of expression
-            if (i == 0 || i == tokens.getSize() - 1) {
-                throw std::runtime_error("Invalid expression: Operator cannot be at the start or end");
-            }
-            // Ensure operators are separated by operands ( not consecutive ).
-            if (i > 0 && isOperator(tokens[i-1])) {
-                throw std::runtime_error("Invalid syntax: Consecutive operators");
-            }
-        }
-        // Check for operands (numbers or variables).
-        else if (isNumber(token) || isVariable(token)) {
-            operandCount++; // Increment operand count.
-            // Check for implicit multiplication (number/variable next to parenthesis)
-            if (i > 0 && (tokens[i-1] == ")" || isNumber(tokens[i-1]) || isVariable(tokens[i-1]))) {
-                throw std::runtime_error("Invalid syntax: Missing operator between operands");
-            }
+        const Token& token = tokens[i];
+
+        switch (token.kind) {
+            // Check for opening parentheses.
+            case TokenKind::LeftParen:
+                open.push_back(i);
+                // Ensure that an operator precedes an opening parenthesis (if applicable).
+                if (i > 0 && (isOperand(tokens[i-1]) || tokens[i-1].kind == TokenKind::RightParen)) {
+                    report(diagnostics, DiagnosticCode::MissingOperatorBeforeParenthesis, tokens, i,
+                           "Invalid syntax: Missing operator before opening parenthesis");
+                }
+                break;
+            // Check for closing parentheses.
+            case TokenKind::RightParen:
+                // Detect unmatched closing parentheses (more closing than opening).
+                if (open.empty()) {
+                    report(diagnostics, DiagnosticCode::TooManyClosingParentheses, tokens, i,
+                           "Unbalanced parentheses: Too many closing parentheses");
+                } else {
+                    open.pop_back();
+                }
+                break;
+            // Check for operators.
+            case TokenKind::Operator:
+                operatorCount++;  // Increment operator count.
+                // Check if operator is at the start or end of expression
+                if (i == 0 || i == tokens.getSize() - 1) {
+                    report(diagnostics, DiagnosticCode::OperatorAtEdge, tokens, i,
+                           "Invalid expression: Operator cannot be at the start or end");
+                }
+                // Ensure operators are separated by operands ( not consecutive ).
+                else if (tokens[i-1].kind == TokenKind::Operator) {
+                    report(diagnostics, DiagnosticCode::ConsecutiveOperators, tokens, i,
+                           "Invalid syntax: Consecutive operators");
+                }
+                break;
+            // Check for operands (numbers or variables).
+            case TokenKind::Number:
+            case TokenKind::Variable:
+                operandCount++; // Increment operand count.
+                // Check for implicit multiplication (number/variable next to parenthesis)
+                if (i > 0 && (tokens[i-1].kind == TokenKind::RightParen || isOperand(tokens[i-1]))) {
+                    report(diagnostics, DiagnosticCode::MissingOperatorBetweenOperands, tokens, i,
+                           "Invalid syntax: Missing operator between operands");
+                }
+                break;
+            // Reject malformed tokens such as 3.14.5 or 1x.
+            case TokenKind::Invalid:
+                report(diagnostics, DiagnosticCode::InvalidToken, tokens, i,
+                       "Invalid token in infix expression: " + std::string(tokens.text(token)));
+                break;
         }
     }
 
     // Final validation checks
-    if (parenthesesBalance != 0) {
-        throw std::runtime_error("Unbalanced parentheses");
+    for (int index : open) {
+        report(diagnostics, DiagnosticCode::UnbalancedParentheses, tokens, index, "Unbalanced parentheses");
     }
 
     // Ensure we have the right balance of operands and operators
     if (operandCount <= operatorCount) {
-        throw std::runtime_error("Incomplete expression: Not enough operands for operators");
+        report(diagnostics, DiagnosticCode::NotEnoughOperands, tokens, -1,
+               "Incomplete expression: Not enough operands for operators");
     }
 }
 
-// Validates the structure of a postfix expression.
-void ExpressionTree::validatePostfixExpressionStructure(const MyVector& tokens) {
-    // Stack to track operand availability
-    MyStack<int> operandStack;
-
-    // Iterate through tokens from left to right
-    for (int i = 0; i < tokens.getSize(); ++i) {
-        const string& token = tokens[i];
-
-        if (isNumber(token) || isVariable(token)) {
-            // Operand found, add to stack
-            operandStack.push(0);
-        }
-        else if (isOperator(token)) {
-            // Check if there are enough operands for this operator
-            int requiredOperands = 2;  // Most operators need 2 operands
-
-            // Check if we have enough operands in the stack
-            if (operandStack.size() < requiredOperands) {
-                throw std::runtime_error("Postfix validation error: Insufficient operands for operator '" + token + "'");
-            }
-
-            // Remove the required number of operand placeholders
-            for (int j = 0; j < requiredOperands; ++j) {
-                if (!operandStack.empty()) {
-                    operandStack.pop();
-                }
-            }
+// Validates the structure of an infix expression.
+// Checks for balanced parentheses, proper operator placement, and overall syntax correctness.
+void ExpressionTree::validateExpressionStructure(const TokenList& tokens) {
+    std::vector<Diagnostic> diagnostics;
+    diagnoseInfix(tokens, diagnostics);
+    if (!diagnostics.empty()) throw std::runtime_error(diagnostics.front().message);
+}
 
-            // The operator consumes operands and becomes a result
-            operandStack.push(0);
-        }
-        else {
-            throw std::runtime_error("Invalid token in postfix expression: " + token);
-        }
-    }
+// Validates the structure of a postfix expression given as string tokens.
+void ExpressionTree::validatePostfixExpressionStructure(const MyVector& tokens) {
+    validatePostfixExpressionStructure(classifyTokens(tokens));
+}
 
-    // Final validation: exactly one operand (the final result) should remain
-    if (operandStack.size() != 1) {
-        throw std::runtime_error("Invalid postfix expression: Incorrect number of operands");
-    }
+// Validates the structure of a postfix expression.
+// Counts the values an evaluation would leave on its stack; no stack is built.
+void ExpressionTree::validatePostfixExpressionStructure(const TokenList& tokens) {
+    std::vector<Diagnostic> diagnostics;
+    buildPolish(nullptr, tokens, false, diagnostics);
+    if (!diagnostics.empty()) throw std::runtime_error(diagnostics.front().message);
 }
 
-// Validates the structure of a prefix expression.
+// Validates the structure of a prefix expression given as string tokens.
 void ExpressionTree::validatePrefixExpressionStructure(const MyVector& tokens) {
-    // Stack to track operand requirements
-    MyStack<int> operandStack;
-
-    // Iterate through tokens from right to left
-    for (int i = tokens.getSize() - 1; i >= 0; --i) {
-        const string& token = tokens[i];
-
-        if (isNumber(token) || isVariable(token)) {
-            // Operand found, add to stack with no further requirements
-            operandStack.push(0);
-        }
-        else if (isOperator(token)) {
-            // Check if there are enough operands for this operator
-            int requiredOperands = 2;  // Most operators need 2 operands
+    validatePrefixExpressionStructure(classifyTokens(tokens));
+}
 
-            // Check if we have enough operands in the stack
-            if (operandStack.size() < requiredOperands) {
-                throw std::runtime_error("Prefix validation error: Insufficient operands for operator '" + token + "'");
-            }
+// Validates the structure of a prefix expression.
+// Counts operands from the right; no stack is built.
+void ExpressionTree::validatePrefixExpressionStructure(const TokenList& tokens) {
+    std::vector<Diagnostic> diagnostics;
+    buildPolish(nullptr, tokens, true, diagnostics);
+    if (!diagnostics.empty()) throw std::runtime_error(diagnostics.front().message);
+}
 
-            // Remove the required number of operand placeholders
-            for (int j = 0; j < requiredOperands; ++j) {
-                if (!operandStack.empty()) {
-                    operandStack.pop();
-                }
-            }
+// Detects the notation from the token arrangement: 1 infix, 2 prefix, 3 postfix, 0 unknown.
+static int detectExpressionType(const TokenList& tokens) {
+    // Prefix: Operator comes first
+    if (tokens[0].kind == TokenKind::Operator) {
+        return 2; // Prefix
+    }
 
-            // The operator itself becomes an operand
-            operandStack.push(0);
-        }
-        else {
-            throw std::runtime_error("Invalid token in prefix expression: " + token);
-        }
+    // Postfix: Operator comes last
+    if (tokens[tokens.getSize() - 1].kind == TokenKind::Operator) {
+        return 3; // Postfix
     }
 
-    // Final validation: exactly one operand (the final result) should remain
-    if (operandStack.size() != 1) {
-        throw std::runtime_error("Invalid prefix expression: Incorrect number of operands");
+    // Infix: Operators are between operands
+    for (int i = 1; i < tokens.getSize() - 1; ++i) {
+        if (tokens[i].kind == TokenKind::Operator) {
+            return 1; // Infix
+        }
     }
+    return 0;
 }
 
-
-// Validate if the expression entered matches the expected type (the one chosen by the user)
-void ExpressionTree::validateExpressionType(const MyVector& tokens, int expectedType) {
-    // expectedType: 1 for Infix, 2 for Prefix, 3 for Postfix
-
+// Reports a missing expression or one in another notation than expectedType.
+// Returns true if the expression is of the expected type.
+static bool diagnoseExpressionType(const TokenList& tokens, int expectedType, std::vector<Diagnostic>& diagnostics) {
     // Check for empty expression, if the user enters nothing
     if (tokens.getSize() < 1) {
-        throw std::runtime_error("Empty expression. Enter an expression and leave spaces between tokens, operators, and parentheses");
+        report(diagnostics, DiagnosticCode::EmptyExpression, tokens, -1,
+               "Empty expression. Enter an expression made of numbers, variables, operators, and parentheses");
+        return false;
     }
 
     // Determine the actual type of expression
-    int actualType = determineExpressionType(tokens);
+    int actualType = detectExpressionType(tokens);
+    if (actualType == 0) {
+        report(diagnostics, DiagnosticCode::UnknownExpressionType, tokens, -1, "Unable to determine expression type");
+        return false;
+    }
 
     // Compare actual type with expected type
     if (actualType != expectedType) {
-        std::string typeNames[] = {"", "Infix", "Prefix", "Postfix"};
-        throw std::runtime_error("Incorrect expression type. Expected " +
-                                 typeNames[expectedType] + ", but got " +
-                                 typeNames[actualType] + " expression.");
+        const char* typeNames[] = {"", "Infix", "Prefix", "Postfix"};
+        std::string expected = expectedType >= 1 && expectedType <= 3 ? typeNames[expectedType] : "Unknown";
+        report(diagnostics, DiagnosticCode::WrongExpressionType, tokens, -1,
+               "Incorrect expression type. Expected " + expected + ", but got " +
+               typeNames[actualType] + " expression.");
+        return false;
     }
+    return true;
 }
 
+// Validate if the expression entered matches the expected type (the one chosen by the user), given string tokens
+void ExpressionTree::validateExpressionType(const MyVector& tokens, int expectedType) {
+    validateExpressionType(classifyTokens(tokens), expectedType);
+}
 
-// Detect expression type based on token arrangement
+// Validate if the expression entered matches the expected type (the one chosen by the user)
+// expectedType: 1 for Infix, 2 for Prefix, 3 for Postfix
+void ExpressionTree::validateExpressionType(const TokenList& tokens, int expectedType) {
+    std::vector<Diagnostic> diagnostics;
+    if (!diagnoseExpressionType(tokens, expectedType, diagnostics)) {
+        throw std::runtime_error(diagnostics.front().message);
+    }
+}
+
+// Detect expression type based on string token arrangement
 int ExpressionTree::determineExpressionType(const MyVector& tokens) {
+    return determineExpressionType(classifyTokens(tokens));
+}
 
-    // Prefix: Operator comes first
-    if (isOperator(tokens[0])) {
-        return 2; // Prefix
-    }
+// Detect expression type based on token arrangement
+int ExpressionTree::determineExpressionType(const TokenList& tokens) {
+    int type = detectExpressionType(tokens);
+    // If no clear type is detected
+    if (type == 0) throw std::runtime_error("Unable to determine expression type");
+    return type;
+}
 
-    // Postfix: Operator comes last
-    if (isOperator(tokens[tokens.getSize() - 1])) {
-        return 3; // Postfix
+// Parses an expression of the given type (1 Infix, 2 Prefix, 3 Postfix) without throwing.
+// Valid input is parsed in a single pass. Malformed input costs one more pass that
+// collects every problem, with its token position, into the result's diagnostics.
+// Input in another notation is still checked as the expected one, after the type problem.
+ExpressionTree::ParseResult ExpressionTree::parse(const TokenList& tokens, int expectedType) {
+    ParseResult result;
+    if (!diagnoseExpressionType(tokens, expectedType, result.diagnostics)) {
+        if (tokens.getSize() > 0 && expectedType == 1) {
+            diagnoseInfix(tokens, result.diagnostics);
+        } else if (tokens.getSize() > 0 && (expectedType == 2 || expectedType == 3)) {
+            buildPolish(nullptr, tokens, expectedType == 2, result.diagnostics);
+        }
+        return result;
     }
 
-    // Infix: Operators are between operands
-    for (int i = 1; i < tokens.getSize() - 1; ++i) {
-        if (isOperator(tokens[i])) {
-            return 1; // Infix
+    if (expectedType == 1) {
+        int operatorCount = 0;
+        BuildSpellings spellings(*this, tokens, 0, tokens.getSize());
+        result.root = own(spellings.keep(prattParse(arena, spellings.shift, tokens, 0, tokens.getSize(), operatorCount)));
+        if (!result.root) {
+            diagnoseInfix(tokens, result.diagnostics);
+            if (result.diagnostics.empty()) {
+                report(result.diagnostics, DiagnosticCode::MalformedExpression, tokens, -1, "Invalid infix expression");
+            }
         }
+    } else {
+        result.root = own(buildPolish(this, tokens, expectedType == 2, result.diagnostics));
     }
+    return result;
+}
 
-    // If no clear type is detected
-    throw std::runtime_error("Unable to determine expression type");
+// Tokenizes and parses an expression of the given type without throwing.
+// New variable names are interned only if the tree is built.
+ExpressionTree::ParseResult ExpressionTree::parse(std::string_view expression, int expectedType) {
+    TokenList tokens;
+    lexTokens(expression, tokens, nullptr);
+    PendingNames names(*symbols, tokens);
+    ParseResult result = parse(tokens, expectedType);
+    names.commit(result.root.get());
+    return result;
 }
 
 
@@ -611,32 +1524,97 @@ unordered_map<std::string, double> ExpressionTree::getVariableValues(ExpressionT
     // Map to store variable names and their corresponding values.
     unordered_map<std::string, double> variableValues;
 
-    // Helper function to traverse the tree and collect variable names.
-    function<void(ExpressionTree::TreeNode*)> collectVariables = [&](ExpressionTree::TreeNode* node) {
-        if (!node) return;  // Base case: If the node is null, return.
+    // Walk the tree in preorder with an explicit stack and prompt for each new variable.
+    WalkStack<ExpressionTree::TreeNode*> stack;
+    if (root) stack.push(root);
+    while (!stack.empty()) {
+        ExpressionTree::TreeNode* node = stack.top();
+        stack.pop();
         // Check if the variable is not already in the map to avoid redundant prompts.
-        if (ExpressionTree::isVariable(node->value)) {
-            if (variableValues.find(node->value) == variableValues.end()) {
-                cout << "Enter the value for variable '" << node->value << "': " << std::endl;
+        if (node->kind == TokenKind::Variable) {
+            const std::string name(spelling(node));
+            if (variableValues.find(name) == variableValues.end()) {
+                cout << "Enter the value for variable '" << name << "': " << std::endl;
                 double value;
-                // cin >> value;
-                // Loop to ensure valid numeric input from the user.
-                while (!(cin >> value)) {
+                std::string word;
+                // Loop to ensure valid numeric input from the user; the whole word must be a number.
+                while (!(cin >> word) || !NumberParser::parse(word, value)) {
                     cin.clear(); // Clear the error flag
                     cin.ignore(numeric_limits<streamsize>::max(), '\n'); // Discard invalid input
-                    cout << "Invalid input! Please enter a numeric value for '" << node->value << "': " << endl;
+                    cout << "Invalid input! Please enter a numeric value for '" << name << "': " << endl;
                 }
                 // Store the entered value in the map.
-                variableValues[node->value] = value;
+                variableValues[name] = value;
             }
         }
-        // Recursively traverse the left and right subtrees.
-        collectVariables(node->left);
-        collectVariables(node->right);
-    };
+        // Visit the left subtree before the right one.
+        if (node->right) stack.push(node->right);
+        if (node->left) stack.push(node->left);
+    }
 
-    // Start the traversal from the root of the tree.
-    collectVariables(root);
     // Return the map containing all variable values.
     return variableValues;
-}
\ No newline at end of file
+}
+// Reads variable values from text, one "name value" or "name = value" per line.
+// Blank lines and lines starting with '#' are skipped. Input is read in large
+// blocks and scanned in place, so files with millions of values load quickly.
+size_t ExpressionTree::loadVariableBindings(std::istream& input, VariableBindings& bindings) {
+    const size_t blockSize = 1 << 20;
+    std::string buffer;
+    size_t kept = 0;          // Bytes of an unfinished line carried to the next block
+    size_t lineNumber = 0;
+    size_t loaded = 0;
+
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+    // Names follow the lexer's grammar: a letter, then letters or digits.
+    auto isAlpha = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); };
+    auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+
+    auto parseLine = [&](const char* p, const char* end) {
+        ++lineNumber;
+        while (p != end && isSpace(*p)) ++p;
+        if (p == end || *p == '#') return;
+        const char* nameStart = p;
+        if (!isAlpha(*p)) throw runtime_error("Invalid variable name on line " + std::to_string(lineNumber));
+        while (p != end && (isAlpha(*p) || isDigit(*p))) ++p;
+        // Anything else attached to the name ("my_var") makes a name no expression can use.
+        if (p != end && !isSpace(*p) && *p != '=') {
+            throw runtime_error("Invalid variable name on line " + std::to_string(lineNumber));
+        }
+        std::string_view name(nameStart, static_cast<size_t>(p - nameStart));
+        while (p != end && isSpace(*p)) ++p;
+        if (p != end && *p == '=') ++p;
+        while (p != end && isSpace(*p)) ++p;
+        double value;
+        const char* numberEnd = NumberParser::parse(p, end, value);
+        if (numberEnd == p) throw runtime_error("Invalid value on line " + std::to_string(lineNumber));
+        p = numberEnd;
+        while (p != end && isSpace(*p)) ++p;
+        if (p != end) throw runtime_error("Unexpected text after value on line " + std::to_string(lineNumber));
+        bindings.set(symbols->intern(name), value);
+        ++loaded;
+    };
+
+    while (true) {
+        buffer.resize(kept + blockSize);
+        input.read(&buffer[kept], static_cast<std::streamsize>(blockSize));
+        size_t filled = kept + static_cast<size_t>(input.gcount());
+        const char* data = buffer.data();
+        size_t lineStart = 0;
+        while (true) {
+            const void* newline = std::memchr(data + lineStart, '\n', filled - lineStart);
+            if (!newline) break;
+            size_t lineEnd = static_cast<size_t>(static_cast<const char*>(newline) - data);
+            parseLine(data + lineStart, data + lineEnd);
+            lineStart = lineEnd + 1;
+        }
+        if (input.gcount() == 0 || !input) {
+            // Last line without a trailing newline
+            if (lineStart < filled) parseLine(data + lineStart, data + filled);
+            break;
+        }
+        kept = filled - lineStart;
+        std::memmove(&buffer[0], data + lineStart, kept);
+    }
+    return loaded;
+}
@@ -3,22 +3,116 @@
 #define EXPRESSION_TREE_H
 
 #include <string>
+#include <string_view>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+#include "Diagnostic.h"
 #include "MyVector.h"
+#include "NodeArena.h"
+#include "SymbolTable.h"
+#include "Token.h"
 #include <unordered_map>
 
+class ThreadPool;
+
+// Node orders for ExpressionTree::relayout
+enum class TreeLayout : uint8_t {
+    DepthFirst,   // Pre-order: a node, its left subtree, then its right subtree
+    VanEmdeBoas   // Recursive blocks of half the levels, good at every cache size
+};
+
 class ExpressionTree {
 public:
-    // Represents a node in the expression tree
+    // Represents a node in the expression tree. Nodes hold no strings, so they are
+    // trivially destructible and a whole arena is freed without visiting them; the
+    // spelling of a node is kept as an id or a text position and read back with spelling().
     struct TreeNode {
-        std::string value;  // Stores the value of the node (operator, number, or variable)
+        TokenKind kind;     // Whether the node is a number, variable, or operator
+        OpCode op;          // Operator code for operator nodes
+        uint32_t symbol;    // Variable id in symbols, position of a number's spelling in spellingText (NoSymbol for operators)
+        double number;      // Value of number nodes, parsed once when the token was lexed
         TreeNode* left;   // Pointer to the left child node
         TreeNode* right;  // Pointer to the right child node
 
-        // Constructor to initialize a node with a given value
-        TreeNode(const std::string& val) : value(val), left(nullptr), right(nullptr) {}
+        // Constructor to initialize a node from an already classified token; textShift
+        // is what keepSpellings returned for the tokens, so a number's spelling is found
+        // at its offset plus textShift
+        TreeNode(const Token& token, uint64_t textShift)
+            : kind(token.kind), op(token.op),
+              symbol(token.kind == TokenKind::Variable ? token.symbol
+                     : token.kind == TokenKind::Operator ? SymbolTable::NoSymbol
+                     : static_cast<uint32_t>(token.offset + textShift)),
+              number(token.kind == TokenKind::Number ? token.number : 0.0),
+              left(nullptr), right(nullptr) {}
     };
 
-    TreeNode* root;  // Root of the expression tree
+    /*
+     * TreeHandle class: Sole owner of a tree built by an ExpressionTree.
+     * The nodes go back to the tree's arena when the handle is destroyed, reset or
+     * assigned, including when an exception unwinds past it, so callers never have to
+     * remember deleteTree. Handles move but never copy; release() hands the root back
+     * to manual ownership. A handle must not outlive the ExpressionTree that made it.
+     * After that tree's reset() the nodes are already gone and the handle frees nothing.
+     */
+    class TreeHandle {
+        ExpressionTree* owner;  // Tree whose arena holds the nodes
+        TreeNode* node;         // Root, or null when empty
+        uint64_t releases;      // The arena's releaseCount() when the handle took the tree
+    public:
+        TreeHandle() : owner(nullptr), node(nullptr), releases(0) {}
+        TreeHandle(ExpressionTree& tree, TreeNode* root)
+            : owner(&tree), node(root), releases(tree.arena.releaseCount()) {}
+        TreeHandle(TreeHandle&& other) noexcept
+            : owner(other.owner), node(nullptr), releases(other.releases) { node = other.release(); }
+        TreeHandle& operator=(TreeHandle&& other) noexcept {
+            if (this != &other) {
+                reset();
+                owner = other.owner;
+                releases = other.releases;
+                node = other.release();
+            }
+            return *this;
+        }
+        ~TreeHandle() { reset(); }
+        TreeHandle(const TreeHandle&) = delete;
+        TreeHandle& operator=(const TreeHandle&) = delete;
+
+        TreeNode* get() const { return node; }
+        TreeNode* operator->() const { return node; }
+        explicit operator bool() const { return node != nullptr; }
+        // Gives up ownership and returns the root; the caller then frees it with deleteTree
+        TreeNode* release() {
+            TreeNode* root = node;
+            node = nullptr;
+            return root;
+        }
+        // Frees the tree now
+        void reset() {
+            if (node && owner->arena.releaseCount() == releases) owner->deleteTree(node);
+            node = nullptr;
+        }
+    };
+
+    // Outcome of parse(): a tree, or every problem found in the input. The root is a
+    // TreeHandle, so the result must not outlive the ExpressionTree that parsed it.
+    struct ParseResult {
+        TreeHandle root;                       // Built tree, freed with the result; empty on error
+        std::vector<Diagnostic> diagnostics;   // Problems in the order they were found
+        bool ok() const { return static_cast<bool>(root); }
+    };
+
+    TreeHandle root;  // Expression held by this tree, freed when replaced or when the tree goes away
+    std::unique_ptr<SymbolTable> ownedSymbols;  // Table of this tree, or null when it shares another's
+    SymbolTable* symbols;  // Variable names interned to dense ids: ownedSymbols or the shared table
+    NodeArena<TreeNode> arena;  // Storage of every node the builders make, freed with the tree
+    // Text one build added to spellingText, kept while number nodes still point into it
+    struct SpellingRegion {
+        uint64_t end;    // End of the region; it starts where the one before it ends
+        size_t numbers;  // Number nodes with their spelling in the region
+    };
+    std::string spellingText;                     // Source text of the builds with number nodes alive; the nodes point into it
+    std::vector<SpellingRegion> spellingRegions;  // Regions of spellingText in order; trailing unused ones are dropped
 
     // Helper functions
     bool isOperator(const std::string& token) const;  // Checks if a token is a mathematical operator
@@ -26,16 +120,43 @@ public:
     bool isNumber(const std::string& str) const; // Checks if a string is a valid number
     static bool isVariable(const std::string& token); // Checks if a token is a valid variable name
     static int precedence(const std::string& op);   // Determines operator precedence
-    void deleteTree(TreeNode* node);  // Recursively deletes tree nodes to prevent memory leaks
+    static int precedence(OpCode op);   // Determines operator precedence from an operator code
+    TokenList toTokenList(const MyVector& tokens);  // Classifies string tokens once for the typed stages
+    void deleteTree(TreeNode* node);  // Returns the nodes of a tree built by this tree to its arena (no recursion)
+    TreeHandle own(TreeNode* node) { return TreeHandle(*this, node); }  // Puts a tree built by this tree under a handle
+    void reset();  // Frees every tree built by this tree at once, handing back whole blocks
+    std::string_view spelling(const TreeNode* node) const;  // Text of a node as written in the source
+    uint64_t keepSpellings(const TokenList& tokens, int begin, int end);  // Copies the text of tokens [begin, end) for their number nodes
+    void dropSpelling(const TreeNode* node);  // Called when a number node is freed or overwritten, so its text can go
+    TreeHandle relayout(TreeHandle root, TreeLayout layout = TreeLayout::DepthFirst);  // Moves a tree into one contiguous run of the arena
+    static TreeNode* copyWithLayout(NodeArena<TreeNode>& arena, const TreeNode* root,
+                                    TreeLayout layout);  // Copies a tree into one contiguous run of another arena
 
     // Constructors and destructors
     ExpressionTree();
+    explicit ExpressionTree(SymbolTable& sharedSymbols);  // Interns into a table shared with other trees
     ~ExpressionTree();
+    ExpressionTree(const ExpressionTree&) = delete;
+    ExpressionTree& operator=(const ExpressionTree&) = delete;
 
-    // Tree building functions for different expression formats
-    TreeNode* buildTreeFromInfix(const std::string& infix);
-    TreeNode* buildTreeFromPrefix(const MyVector& tokens);
-    TreeNode* buildTreeFromPostfix(const MyVector& tokens);
+    // Exception-free entry points: expectedType is 1 Infix, 2 Prefix, 3 Postfix
+    ParseResult parse(const TokenList& tokens, int expectedType);
+    ParseResult parse(std::string_view expression, int expectedType);
+
+    // Tree building functions for different expression formats. Each returns the tree
+    // under a handle, so a tree the caller drops or loses to an exception is freed.
+    TreeHandle buildTreeFromInfix(const std::string& infix);
+    TreeHandle buildTreeFromInfix(const TokenList& tokens);  // Validates, checks the type and builds in one pass
+    TreeNode* parseInfixRange(const TokenList& tokens, int begin, int end,
+                              std::vector<TreeNode*>* owners = nullptr);  // Null on a syntax error
+    TreeHandle buildTreeFromInfixParallel(const TokenList& tokens,
+                                          ThreadPool* pool = nullptr);  // Same tree, built on a pool
+    TreeHandle buildTreeFromPrefix(const MyVector& tokens);
+    TreeHandle buildTreeFromPrefix(const TokenList& tokens);
+    TreeHandle buildTreeFromPostfix(const MyVector& tokens);
+    TreeHandle buildTreeFromPostfix(const TokenList& tokens);
+    TreeHandle buildTreeFromPostfixParallel(const TokenList& tokens,
+                                            ThreadPool* pool = nullptr);  // Same tree, built on a pool
 
     // Traversal functions
     std::string inorder(TreeNode* root) const; // Gives infix expression
@@ -44,9 +165,20 @@ public:
 
     // Evaluation and tokenization functions
     long double evaluate(TreeNode* root, const std::unordered_map<std::string, double>& variableValues) const;
+    long double evaluate(TreeNode* root, const VariableBindings& variableValues) const;  // Values indexed by symbol id
     MyVector tokenize(const std::string& expression) const;
+    void tokenize(std::string_view expression, TokenList& tokens);  // Typed tokens, classified once
+    void tokenizeParallel(std::string_view expression, TokenList& tokens,
+                          ThreadPool* pool = nullptr);  // Same tokens, lexed on a pool (default: all cores)
 
     //Expression Validation Functions
+    void validateExpressionType(const TokenList& tokens, int expectedType);
+    int  determineExpressionType(const TokenList& tokens);
+    void validateExpressionStructure(const TokenList& tokens);
+    void validatePostfixExpressionStructure(const TokenList& tokens);
+    void validatePrefixExpressionStructure(const TokenList& tokens);
+
+    // String-token versions of the validation functions; they classify the tokens and call the typed ones
     void validateExpressionType(const MyVector& tokens, int expectedType);
     int  determineExpressionType(const MyVector& tokens);
     void validateExpressionStructure(const MyVector& tokens);
@@ -55,6 +187,8 @@ public:
 
     // A function to collect variable values for evaluation
     unordered_map<std::string, double> getVariableValues(ExpressionTree::TreeNode* root);
+    // Reads "name value" or "name = value" lines into bindings; returns the number of values read
+    size_t loadVariableBindings(std::istream& input, VariableBindings& bindings);
 
 };
 
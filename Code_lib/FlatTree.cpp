@@ -0,0 +1,423 @@
+#include "FlatTree.h"
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include "NotationConverter.h"
+
+// Constructor : Starts empty; with shareSubexpressions the builders hash-cons
+FlatTree::FlatTree(bool shareSubexpressions) : symbols(nullptr), sharing(shareSubexpressions), shared(false) {}
+
+// Hashes the fields that make two nodes the same subexpression.
+size_t FlatTree::NodeKeyHash::operator()(const NodeKey& key) const {
+    uint64_t hash = key.bits * 0x9E3779B97F4A7C15ull;
+    hash ^= (uint64_t(key.left) << 32 | key.right) + 0x632BE59BD9B4E019ull + (hash << 6) + (hash >> 2);
+    hash ^= static_cast<uint64_t>(key.tag) + (hash << 6) + (hash >> 2);
+    return static_cast<size_t>(hash);
+}
+
+// Empties the arrays before a build of up to nodeCount nodes.
+void FlatTree::start(const ExpressionTree& tree, size_t nodeCount) {
+    tags.clear();
+    numbers.clear();
+    left.clear();
+    right.clear();
+    spellings.clear();
+    tags.reserve(nodeCount);
+    numbers.reserve(nodeCount);
+    left.reserve(nodeCount);
+    right.reserve(nodeCount);
+    interned.clear();
+    spellingOffsets.clear();
+    shared = false;
+    symbols = tree.symbols;
+}
+
+// Appends one node and returns its index. When sharing, a node equal to one already
+// stored (same tag, value and children) is not appended; the stored one is returned.
+// Children are themselves shared, so comparing their indices compares whole subtrees.
+uint32_t FlatTree::append(NodeTag tag, double number, uint32_t leftIndex, uint32_t rightIndex) {
+    if (sharing) {
+        NodeKey key{0, leftIndex, rightIndex, tag};
+        std::memcpy(&key.bits, &number, sizeof(number));
+        std::pair<std::unordered_map<NodeKey, uint32_t, NodeKeyHash>::iterator, bool> entry =
+            interned.emplace(key, static_cast<uint32_t>(tags.size()));
+        if (!entry.second) {
+            shared = true;
+            return entry.first->second;
+        }
+    }
+    tags.push_back(tag);
+    numbers.push_back(number);
+    left.push_back(leftIndex);
+    right.push_back(rightIndex);
+    return static_cast<uint32_t>(tags.size() - 1);
+}
+
+// Appends a number or variable token. A number's spelling is added to spellings; when
+// sharing, a spelling already there is reused so equal literals get equal keys.
+uint32_t FlatTree::appendOperand(const Token& token, std::string_view text, SymbolTable& table) {
+    if (token.kind == TokenKind::Number) {
+        uint32_t offset = static_cast<uint32_t>(spellings.size());
+        if (sharing) offset = spellingOffsets.emplace(std::string(text), offset).first->second;
+        if (offset == spellings.size()) spellings += text;
+        return append(NodeTag::Number, token.number, offset, static_cast<uint32_t>(text.size()));
+    }
+    uint32_t id = token.symbol != SymbolTable::NoSymbol ? token.symbol : table.intern(text);
+    return append(NodeTag::Variable, 0, id, NoChild);
+}
+
+// Builds from infix tokens: the shunting-yard pass hands over the tokens in postfix
+// order, which is the order the nodes are stored in.
+void FlatTree::buildFromInfix(ExpressionTree& tree, const TokenList& tokens) {
+    tree.validateExpressionType(tokens, 1);
+    tree.validateExpressionStructure(tokens);
+    start(tree, tokens.getSize());
+
+    std::vector<uint32_t> operands;  // Finished subtrees waiting for an operator
+    NotationConverter converter(tree);
+    converter.shuntingYard(tokens, false, [&](int i) {
+        const Token& token = tokens[i];
+        if (token.kind != TokenKind::Operator) {
+            operands.push_back(appendOperand(token, tokens.text(token), *tree.symbols));
+            return;
+        }
+        uint32_t rightIndex = operands.back();
+        operands.pop_back();
+        operands.back() = append(operatorTag(token.op), 0, operands.back(), rightIndex);
+    });
+}
+
+// Builds from prefix tokens read left to right. Each operator waits on a stack until
+// both its operands are stored, then follows them, which gives post-order directly.
+void FlatTree::buildFromPrefix(ExpressionTree& tree, const TokenList& tokens) {
+    tree.validateExpressionType(tokens, 2);
+    tree.validatePrefixExpressionStructure(tokens);
+    start(tree, tokens.getSize());
+
+    struct Pending {
+        OpCode op;
+        uint32_t leftIndex;  // NoChild until the left operand is stored
+    };
+    std::vector<Pending> pending;
+    for (int i = 0; i < tokens.getSize(); ++i) {
+        const Token& token = tokens[i];
+        if (token.kind == TokenKind::Operator) {
+            pending.push_back({token.op, NoChild});
+            continue;
+        }
+        uint32_t index = appendOperand(token, tokens.text(token), *tree.symbols);
+        // Store every operator this operand completes.
+        while (!pending.empty() && pending.back().leftIndex != NoChild) {
+            index = append(operatorTag(pending.back().op), 0, pending.back().leftIndex, index);
+            pending.pop_back();
+        }
+        if (!pending.empty()) pending.back().leftIndex = index;
+    }
+}
+
+// Builds from postfix tokens, which are already in post-order.
+void FlatTree::buildFromPostfix(ExpressionTree& tree, const TokenList& tokens) {
+    tree.validateExpressionType(tokens, 3);
+    tree.validatePostfixExpressionStructure(tokens);
+    start(tree, tokens.getSize());
+
+    std::vector<uint32_t> operands;
+    for (int i = 0; i < tokens.getSize(); ++i) {
+        const Token& token = tokens[i];
+        if (token.kind != TokenKind::Operator) {
+            operands.push_back(appendOperand(token, tokens.text(token), *tree.symbols));
+            continue;
+        }
+        uint32_t rightIndex = operands.back();
+        operands.pop_back();
+        operands.back() = append(operatorTag(token.op), 0, operands.back(), rightIndex);
+    }
+}
+
+// Evaluates in one forward scan: every operand is finished before its operator.
+// A tree uses each value once, so the values live on a stack; a DAG keeps the value
+// of every node, so a shared subexpression is computed once and read by each user.
+double FlatTree::evaluate(const VariableBindings& variableValues) const {
+    if (tags.empty()) return 0;
+    if (shared) return evaluateShared(variableValues);
+    std::vector<double> values;
+    values.reserve(32);
+
+    const size_t count = tags.size();
+    for (size_t i = 0; i < count; ++i) {
+        const NodeTag tag = tags[i];
+        if (tag == NodeTag::Number) {
+            values.push_back(numbers[i]);
+        } else if (tag == NodeTag::Variable) {
+            const double* value = variableValues.find(left[i]);
+            if (!value) throw std::runtime_error("Undefined variable: " + std::string(symbols->name(left[i])));
+            values.push_back(*value);
+        } else {
+            const double rightValue = values.back();
+            values.pop_back();
+            values.back() = applyOperator(tagOperator(tag), values.back(), rightValue);
+        }
+    }
+    return values.back();
+}
+
+// Evaluates a DAG: node i's value is values[i].
+double FlatTree::evaluateShared(const VariableBindings& variableValues) const {
+    const size_t count = tags.size();
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        const NodeTag tag = tags[i];
+        if (tag == NodeTag::Number) {
+            values[i] = numbers[i];
+        } else if (tag == NodeTag::Variable) {
+            const double* value = variableValues.find(left[i]);
+            if (!value) throw std::runtime_error("Undefined variable: " + std::string(symbols->name(left[i])));
+            values[i] = *value;
+        } else {
+            values[i] = applyOperator(tagOperator(tag), values[left[i]], values[right[i]]);
+        }
+    }
+    return values.back();
+}
+
+// Appends the text of one node.
+void FlatTree::writeNode(std::string& output, uint32_t index) const {
+    if (tags[index] == NodeTag::Number) {
+        output += spelling(index);
+    } else if (tags[index] == NodeTag::Variable) {
+        output += symbols->name(left[index]);
+    } else {
+        output += opText(tagOperator(tags[index]));
+    }
+}
+
+// Writes the fully parenthesized infix form, following the child indices.
+std::string FlatTree::inorder() const {
+    std::string result;
+    if (tags.empty()) return result;
+    std::vector<std::pair<uint32_t, int>> stack;  // Node and how much of it is written
+    stack.push_back({root(), 0});
+    while (!stack.empty()) {
+        std::pair<uint32_t, int>& entry = stack.back();
+        const uint32_t node = entry.first;
+        if (tags[node] == NodeTag::Number || tags[node] == NodeTag::Variable) {
+            writeNode(result, node);
+            stack.pop_back();
+        } else if (entry.second == 0) {
+            result += "( ";
+            entry.second = 1;
+            stack.push_back({left[node], 0});
+        } else if (entry.second == 1) {
+            result += ' ';
+            writeNode(result, node);
+            result += ' ';
+            entry.second = 2;
+            stack.push_back({right[node], 0});
+        } else {
+            result += " )";
+            stack.pop_back();
+        }
+    }
+    return result;
+}
+
+// Writes the prefix form, following the child indices.
+std::string FlatTree::preorder() const {
+    std::string result;
+    if (tags.empty()) return result;
+    std::vector<uint32_t> stack = {root()};
+    while (!stack.empty()) {
+        const uint32_t node = stack.back();
+        stack.pop_back();
+        if (!result.empty()) result += ' ';
+        writeNode(result, node);
+        if (tags[node] != NodeTag::Number && tags[node] != NodeTag::Variable) {
+            stack.push_back(right[node]);
+            stack.push_back(left[node]);
+        }
+    }
+    return result;
+}
+
+// Writes the postfix form: the nodes in storage order, or for a DAG, following the
+// child indices so shared subexpressions are written at each use.
+std::string FlatTree::postorder() const {
+    std::string result;
+    if (shared) {
+        std::vector<std::pair<uint32_t, bool>> stack = {{root(), false}};  // Node and whether its children are written
+        while (!stack.empty()) {
+            std::pair<uint32_t, bool> entry = stack.back();
+            stack.pop_back();
+            const uint32_t node = entry.first;
+            if (entry.second || tags[node] == NodeTag::Number || tags[node] == NodeTag::Variable) {
+                if (!result.empty()) result += ' ';
+                writeNode(result, node);
+                continue;
+            }
+            stack.push_back({node, true});
+            stack.push_back({right[node], false});
+            stack.push_back({left[node], false});
+        }
+        return result;
+    }
+    for (uint32_t i = 0; i < tags.size(); ++i) {
+        if (i > 0) result += ' ';
+        writeNode(result, i);
+    }
+    return result;
+}
+
+// Binary layout: "ETFT", node count, a flags byte (1 if nodes are shared), the four
+// arrays, the length and text of the number spellings, then the name of every variable
+// id used. Numbers and indices are in the machine's byte order.
+static const char flatTreeMagic[4] = {'E', 'T', 'F', 'T'};
+
+// Writes a block of plain values.
+template<typename T>
+static void writeArray(std::ostream& output, const T* data, size_t count) {
+    output.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+// Reads a block of plain values, failing on a short read.
+template<typename T>
+static void readArray(std::istream& input, T* data, size_t count) {
+    input.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+    if (static_cast<size_t>(input.gcount()) != count * sizeof(T)) throw std::runtime_error("Invalid flat tree data");
+}
+
+// Reads count plain values into a vector or string, growing it 64 KB at a time, so a
+// corrupt count fails on the short read instead of allocating it all up front.
+template<typename Container>
+static void readGrowing(std::istream& input, Container& values, uint64_t count) {
+    constexpr size_t chunk = 64 * 1024 / sizeof(typename Container::value_type);
+    values.clear();
+    while (values.size() < count) {
+        const size_t start = values.size();
+        const size_t length = static_cast<size_t>(std::min<uint64_t>(chunk, count - start));
+        values.resize(start + length);
+        readArray(input, &values[start], length);
+    }
+}
+
+// Writes the arrays, the number spellings and the variable names to a binary stream
+void FlatTree::save(std::ostream& output) const {
+    const uint64_t count = tags.size();
+    output.write(flatTreeMagic, sizeof(flatTreeMagic));
+    const uint8_t flags = shared ? 1 : 0;
+    writeArray(output, &count, 1);
+    writeArray(output, &flags, 1);
+    writeArray(output, tags.data(), tags.size());
+    writeArray(output, numbers.data(), numbers.size());
+    writeArray(output, left.data(), left.size());
+    writeArray(output, right.data(), right.size());
+    const uint64_t spellingLength = spellings.size();
+    writeArray(output, &spellingLength, 1);
+    output.write(spellings.data(), static_cast<std::streamsize>(spellings.size()));
+
+    // Names of the ids used, each once.
+    std::vector<uint32_t> ids;
+    std::unordered_map<uint32_t, bool> seen;
+    for (size_t i = 0; i < tags.size(); ++i) {
+        if (tags[i] == NodeTag::Variable && !seen[left[i]]) {
+            seen[left[i]] = true;
+            ids.push_back(left[i]);
+        }
+    }
+    const uint32_t idCount = static_cast<uint32_t>(ids.size());
+    writeArray(output, &idCount, 1);
+    for (uint32_t id : ids) {
+        std::string_view name = symbols->name(id);
+        const uint32_t length = static_cast<uint32_t>(name.size());
+        writeArray(output, &id, 1);
+        writeArray(output, &length, 1);
+        output.write(name.data(), length);
+    }
+}
+
+// Reads a tree written by save, interning its variable names into symbolTable.
+// Rejects data that is truncated or is not a valid post-order tree (or DAG).
+void FlatTree::load(std::istream& input, SymbolTable& symbolTable) {
+    char magic[sizeof(flatTreeMagic)];
+    readArray(input, magic, sizeof(magic));
+    if (std::memcmp(magic, flatTreeMagic, sizeof(magic)) != 0) throw std::runtime_error("Invalid flat tree data");
+    uint64_t count = 0;
+    readArray(input, &count, 1);
+    if (count > 0xFFFFFFFFu) throw std::runtime_error("Invalid flat tree data");
+    uint8_t flags = 0;
+    readArray(input, &flags, 1);
+    if (flags > 1) throw std::runtime_error("Invalid flat tree data");
+
+    std::vector<NodeTag> newTags;
+    std::vector<double> newNumbers;
+    std::vector<uint32_t> newLeft;
+    std::vector<uint32_t> newRight;
+    std::string newSpellings;
+    readGrowing(input, newTags, count);
+    readGrowing(input, newNumbers, count);
+    readGrowing(input, newLeft, count);
+    readGrowing(input, newRight, count);
+    uint64_t spellingLength = 0;
+    readArray(input, &spellingLength, 1);
+    if (spellingLength > 0xFFFFFFFFu) throw std::runtime_error("Invalid flat tree data");
+    readGrowing(input, newSpellings, spellingLength);
+
+    // Map the saved ids to ids in the given table.
+    uint32_t idCount = 0;
+    readArray(input, &idCount, 1);
+    std::unordered_map<uint32_t, uint32_t> ids;
+    for (uint32_t k = 0; k < idCount; ++k) {
+        uint32_t id = 0;
+        uint32_t length = 0;
+        readArray(input, &id, 1);
+        readArray(input, &length, 1);
+        std::string name;
+        readGrowing(input, name, length);
+        ids[id] = symbolTable.intern(name);
+    }
+
+    // Check the post-order shape by replaying it on a stack of finished subtrees. In a
+    // tree an operator's children are the top two entries and one root is left; in a
+    // DAG they may be any earlier nodes.
+    std::vector<uint32_t> operands;
+    for (uint32_t i = 0; i < count; ++i) {
+        const NodeTag tag = newTags[i];
+        if (tag == NodeTag::Number) {
+            if (newLeft[i] > newSpellings.size() || newRight[i] > newSpellings.size() - newLeft[i]) {
+                throw std::runtime_error("Invalid flat tree data");
+            }
+        } else if (tag == NodeTag::Variable) {
+            auto found = ids.find(newLeft[i]);
+            if (found == ids.end()) throw std::runtime_error("Invalid flat tree data");
+            newLeft[i] = found->second;
+        } else if (!isOperatorTag(tag) || newLeft[i] >= i || newRight[i] >= i) {
+            throw std::runtime_error("Invalid flat tree data");
+        }
+        if (flags) continue;
+
+        if (!isOperatorTag(tag)) {
+            operands.push_back(i);
+            continue;
+        }
+        const size_t depth = operands.size();
+        if (depth < 2 || operands[depth - 2] != newLeft[i] || operands[depth - 1] != newRight[i]) {
+            throw std::runtime_error("Invalid flat tree data");
+        }
+        operands.pop_back();
+        operands.back() = i;
+    }
+    if (count > 0 && !flags && operands.size() != 1) throw std::runtime_error("Invalid flat tree data");
+
+    tags.swap(newTags);
+    numbers.swap(newNumbers);
+    left.swap(newLeft);
+    right.swap(newRight);
+    spellings.swap(newSpellings);
+    interned.clear();
+    spellingOffsets.clear();
+    shared = flags != 0;
+    symbols = &symbolTable;
+}
@@ -0,0 +1,112 @@
+#ifndef FLAT_TREE_H
+#define FLAT_TREE_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "CompactTree.h"
+#include "ExpressionTree.h"
+#include "SymbolTable.h"
+#include "Token.h"
+
+/*
+ * FlatTree class: An expression tree as parallel arrays (structure of arrays)
+ * stored contiguously in post-order: the tag, number value, left child index and
+ * right child index of node i are tags[i], numbers[i], left[i] and right[i]. For a
+ * variable, left[i] holds its symbol id; for a number, left[i] and right[i] hold the
+ * offset and length of its source spelling in spellings. The root is the last node.
+ * The builders append nodes as they read the tokens, so no pointer tree is made.
+ * Post-order puts every operand before its operator, so evaluation and the postfix
+ * traversal are one forward scan over the arrays; the other traversals follow the
+ * child indices with an explicit stack.
+ * The arrays hold no pointers, so a FlatTree is copied with memcpy-speed vector
+ * copies, written to and read from a stream in a few bulk writes, and evaluated from
+ * any number of threads at once.
+ * Numbers are written back as they were spelled, so "3.50" and "100000000000000000000000"
+ * read back unchanged.
+ * A FlatTree made with shareSubexpressions hash-conses while building: a node equal
+ * to one already stored is not appended again, so "( A * B + C ) ^ 2 - ( A * B + C ) / D"
+ * stores A * B + C once and the result is a DAG. Every distinct subexpression is then
+ * evaluated once per evaluate, and the traversals still write every use of it.
+ */
+class FlatTree {
+public:
+    static constexpr uint32_t NoChild = 0xFFFFFFFFu;  // Child index of leaves
+
+private:
+    std::vector<NodeTag> tags;
+    std::vector<double> numbers;   // Value of number nodes (0 otherwise)
+    std::vector<uint32_t> left;    // Left child, symbol id of a variable, or spelling offset of a number
+    std::vector<uint32_t> right;   // Right child, or spelling length of a number
+    std::string spellings;         // Source text of the number literals, back to back
+    const SymbolTable* symbols;    // Names of the variable ids
+
+    // Identity of a node for hash-consing: children are already shared, so equal
+    // keys mean equal subexpressions.
+    struct NodeKey {
+        uint64_t bits;      // Bits of the number value
+        uint32_t left;
+        uint32_t right;
+        NodeTag tag;
+        bool operator==(const NodeKey& other) const {
+            return bits == other.bits && left == other.left && right == other.right && tag == other.tag;
+        }
+    };
+    struct NodeKeyHash {
+        size_t operator()(const NodeKey& key) const;
+    };
+    std::unordered_map<NodeKey, uint32_t, NodeKeyHash> interned;  // Nodes stored so far, when sharing
+    std::unordered_map<std::string, uint32_t> spellingOffsets;     // Spellings stored so far, when sharing
+    bool sharing;  // True if the builders hash-cons
+    bool shared;   // True if some node has more than one parent
+
+    void start(const ExpressionTree& tree, size_t nodeCount);
+
+    uint32_t append(NodeTag tag, double number, uint32_t leftIndex, uint32_t rightIndex);
+    uint32_t appendOperand(const Token& token, std::string_view text, SymbolTable& table);
+    void writeNode(std::string& output, uint32_t index) const;
+    double evaluateShared(const VariableBindings& variableValues) const;
+
+public:
+    // Constructor : Starts empty; with shareSubexpressions the builders make a DAG
+    explicit FlatTree(bool shareSubexpressions = false);
+
+    // Builders: validate with the tree's validators (and their messages), then append nodes in post-order
+    void buildFromInfix(ExpressionTree& tree, const TokenList& tokens);
+    void buildFromPrefix(ExpressionTree& tree, const TokenList& tokens);
+    void buildFromPostfix(ExpressionTree& tree, const TokenList& tokens);
+
+    // Evaluates with values indexed by symbol id
+    double evaluate(const VariableBindings& variableValues) const;
+
+    // Traversals, in the format of ExpressionTree::inorder, preorder and postorder
+    std::string inorder() const;
+    std::string preorder() const;
+    std::string postorder() const;
+
+    // Writes the arrays, the number spellings and the variable names to a binary stream
+    void save(std::ostream& output) const;
+    // Reads a tree written by save, interning its variable names into symbolTable.
+    // Rejects data that is truncated or is not a valid post-order tree (or DAG).
+    void load(std::istream& input, SymbolTable& symbolTable);
+
+    // Returns true if the last build shared a subexpression (the nodes form a DAG)
+    bool isShared() const { return shared; }
+    // Returns the number of nodes (distinct subexpressions when sharing)
+    size_t size() const { return tags.size(); }
+    // Returns the index of the root (the last node)
+    uint32_t root() const { return static_cast<uint32_t>(tags.size() - 1); }
+    NodeTag tag(uint32_t index) const { return tags[index]; }
+    double number(uint32_t index) const { return numbers[index]; }
+    // Returns the source spelling of a number node
+    std::string_view spelling(uint32_t index) const {
+        return std::string_view(spellings).substr(left[index], right[index]);
+    }
+    uint32_t leftChild(uint32_t index) const { return left[index]; }
+    uint32_t rightChild(uint32_t index) const { return right[index]; }
+};
+
+#endif // FLAT_TREE_H
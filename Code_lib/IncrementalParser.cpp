@@ -0,0 +1,502 @@
+#include "IncrementalParser.h"
+#include "Lexer.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+using TreeNode = ExpressionTree::TreeNode;
+
+// Precedence of a span with no operator at its level: tighter than any operator.
+static const int NoOperator = INT_MAX;
+
+// Returns true for numbers and variables.
+static bool isOperandToken(const Token& token) {
+    return token.kind == TokenKind::Number || token.kind == TokenKind::Variable;
+}
+
+// Returns true if a new token can take the place of an old one without changing the tree's shape.
+static bool canReplace(const Token& before, const Token& after) {
+    if (isOperandToken(before) && isOperandToken(after)) return true;
+    if (before.kind == TokenKind::Operator && after.kind == TokenKind::Operator) {
+        return ExpressionTree::precedence(before.op) == ExpressionTree::precedence(after.op);
+    }
+    return (before.kind == TokenKind::LeftParen || before.kind == TokenKind::RightParen) && before.kind == after.kind;
+}
+
+// Returns true if the parentheses in [first, last) pair up among themselves.
+static bool balancedTokens(const Token* first, const Token* last) {
+    int depth = 0;
+    for (; first != last; ++first) {
+        if (first->kind == TokenKind::LeftParen) ++depth;
+        if (first->kind == TokenKind::RightParen && --depth < 0) return false;
+    }
+    return depth == 0;
+}
+
+// Counts the operator tokens in [first, last).
+static int countOperators(const Token* first, const Token* last) {
+    return static_cast<int>(std::count_if(first, last, [](const Token& token) { return token.kind == TokenKind::Operator; }));
+}
+
+// Calls visit(k, token) for every operator outside parentheses among the balanced
+// tokens at(0) .. at(count - 1).
+template<typename At, typename Visit>
+static void forEachTopOperator(int count, At at, Visit visit) {
+    int depth = 0;
+    for (int k = 0; k < count; ++k) {
+        const Token& token = at(k);
+        if (token.kind == TokenKind::LeftParen) {
+            ++depth;
+        } else if (token.kind == TokenKind::RightParen) {
+            --depth;
+        } else if (token.kind == TokenKind::Operator && depth == 0) {
+            visit(k, token);
+        }
+    }
+}
+
+// Throws the error buildTreeFromInfix reports for tokens the parser rejected.
+[[noreturn]] static void throwInfixError(ExpressionTree& tree, const TokenList& tokens) {
+    tree.buildTreeFromInfix(tokens);
+    throw std::runtime_error("Invalid infix expression");
+}
+
+// Constructor : Starts with no expression; nodes and names go through the given tree
+IncrementalParser::IncrementalParser(ExpressionTree& expressionTree)
+    : tree(expressionTree), textGap(0), textGapSize(0), tokenGap(0), tokenGapSize(0),
+      root(nullptr), operatorCount(0), reparsed(0) {}
+
+// Destructor : Frees the tree
+IncrementalParser::~IncrementalParser() {
+    tree.deleteTree(root);
+}
+
+// Returns the offset of a token in the text without the gap.
+uint64_t IncrementalParser::offsetOf(int index) const {
+    if (index < tokenGap) return tokens.tokens[index].offset;
+    return textLength() - tokens.tokens[index + tokenGapSize].offset;
+}
+
+// Returns a character of the text without the gap.
+char IncrementalParser::charAt(size_t position) const {
+    return tokens.source[position < textGap ? position : position + textGapSize];
+}
+
+// Moves the text gap to position, moving only the characters in between.
+void IncrementalParser::moveTextGap(size_t position) const {
+    std::string& text = tokens.source;
+    if (position < textGap) {
+        std::memmove(&text[position + textGapSize], &text[position], textGap - position);
+    } else if (position > textGap) {
+        std::memmove(&text[textGap], &text[textGap + textGapSize], position - textGap);
+    }
+    textGap = position;
+}
+
+// Moves the token gap in front of token index. Tokens that cross it switch between
+// offsets from the start and from the end of the text.
+void IncrementalParser::moveTokenGap(int index) const {
+    const uint64_t length = textLength();
+    std::vector<Token>& list = tokens.tokens;
+    while (tokenGap > index) {
+        --tokenGap;
+        Token token = list[tokenGap];
+        token.offset = length - token.offset;
+        list[tokenGap + tokenGapSize] = token;
+        owners[tokenGap + tokenGapSize] = owners[tokenGap];
+    }
+    while (tokenGap < index) {
+        Token token = list[tokenGap + tokenGapSize];
+        token.offset = length - token.offset;
+        list[tokenGap] = token;
+        owners[tokenGap] = owners[tokenGap + tokenGapSize];
+        ++tokenGap;
+    }
+}
+
+// Makes the text gap at least count characters long, growing it by half the text at a time.
+void IncrementalParser::reserveTextGap(size_t count) {
+    if (textGapSize >= count) return;
+    size_t grow = std::max(count - textGapSize, tokens.source.size() / 2 + 64);
+    tokens.source.insert(textGap, grow, '\0');
+    textGapSize += grow;
+}
+
+// Makes the token gap at least count tokens long, growing it by half the tokens at a time.
+void IncrementalParser::reserveTokenGap(int count) {
+    if (tokenGapSize >= count) return;
+    int grow = std::max(count - tokenGapSize, static_cast<int>(tokens.tokens.size() / 2) + 16);
+    tokens.tokens.insert(tokens.tokens.begin() + tokenGap, grow, Token());
+    owners.insert(owners.begin() + tokenGap, grow, nullptr);
+    tokenGapSize += grow;
+}
+
+// Moves both gaps to the end and drops them, leaving a plain token list.
+void IncrementalParser::closeGaps() const {
+    const size_t length = textLength();
+    moveTextGap(length);
+    tokens.source.resize(length);
+    textGapSize = 0;
+    const int count = tokenCount();
+    moveTokenGap(count);
+    if (tokenGapSize > 0) {
+        tokens.tokens.resize(count);
+        owners.resize(count);
+        tokenGapSize = 0;
+    }
+}
+
+// Returns the current text
+const std::string& IncrementalParser::text() const {
+    closeGaps();
+    return tokens.source;
+}
+
+// Returns the current tokens
+const TokenList& IncrementalParser::getTokens() const {
+    closeGaps();
+    return tokens;
+}
+
+// Parses the whole token list, recording the node of every token.
+// Returns null, leaving the owners alone, if it is not a valid infix expression.
+TreeNode* IncrementalParser::reparseAll() {
+    closeGaps();
+    const int size = tokens.getSize();
+    if (size == 0 || operatorCount == 0 || tokens[0].kind == TokenKind::Operator ||
+        tokens[size - 1].kind == TokenKind::Operator) {
+        return nullptr;
+    }
+    std::vector<TreeNode*> fresh(tokens.tokens.size(), nullptr);
+    TreeNode* parsed = tree.parseInfixRange(tokens, 0, size, &fresh);
+    if (parsed) {
+        owners.swap(fresh);
+        reparsed = size;
+    }
+    return parsed;
+}
+
+// Reparses the region around the new tokens [first, first + count), which replaced
+// oldTokens, and splices its tree into the nodes around it.
+// The region reaches, inside the innermost group, to the nearest operators that bind
+// no tighter than the weakest operator the edit touches. Operators of exactly that
+// precedence form a chain (a left-leaning spine, or right-leaning for '^'); when the
+// region sits between links of the chain, only its own links are replaced: the
+// neighbour below it ("deeper") gets the region's first operand, and the neighbour
+// above it ("upper") gets the region's top. Without an upper neighbour the new top
+// is moved into the node the old top used, so the parent, a group's parentheses or
+// the root need no update. Returns false, changing nothing, if the region does not parse.
+bool IncrementalParser::reparseRegion(int first, int count, const std::vector<Token>& oldTokens,
+                                      const std::vector<TreeNode*>& oldOwners) {
+    const int size = tokenCount();
+    const int oldCount = static_cast<int>(oldTokens.size());
+
+    // Weakest operator outside parentheses among the old and the new tokens.
+    int weakest = NoOperator;
+    auto weaken = [&](int, const Token& token) { weakest = std::min(weakest, ExpressionTree::precedence(token.op)); };
+    forEachTopOperator(oldCount, [&](int k) -> const Token& { return oldTokens[k]; }, weaken);
+    forEachTopOperator(count, [&](int k) -> const Token& { return tokenAt(first + k); }, weaken);
+    const bool rightAssociative = weakest == ExpressionTree::precedence(OpCode::Power);
+    auto bounds = [&](const Token& token) {
+        return token.kind == TokenKind::Operator && ExpressionTree::precedence(token.op) <= weakest;
+    };
+    auto chained = [&](const Token& token) {
+        return token.kind == TokenKind::Operator && ExpressionTree::precedence(token.op) == weakest;
+    };
+
+    // Extend to the bounding operators or the group's parentheses, stepping over inner groups.
+    int regionBegin = first;
+    for (int depth = 0; regionBegin > 0; --regionBegin) {
+        const Token& token = tokenAt(regionBegin - 1);
+        if (token.kind == TokenKind::RightParen) {
+            ++depth;
+        } else if (token.kind == TokenKind::LeftParen) {
+            if (depth == 0) break;
+            --depth;
+        } else if (depth == 0 && bounds(token)) {
+            break;
+        }
+    }
+    int regionEnd = first + count;
+    for (int depth = 0; regionEnd < size; ++regionEnd) {
+        const Token& token = tokenAt(regionEnd);
+        if (token.kind == TokenKind::LeftParen) {
+            ++depth;
+        } else if (token.kind == TokenKind::RightParen) {
+            if (depth == 0) break;
+            --depth;
+        } else if (depth == 0 && bounds(token)) {
+            break;
+        }
+    }
+    const int oldSize = regionEnd - regionBegin - count + oldCount;
+    if (regionBegin == regionEnd || oldSize == 0) return false;
+
+    TreeNode* before = regionBegin > 0 && chained(tokenAt(regionBegin - 1)) ? ownerAt(regionBegin - 1) : nullptr;
+    TreeNode* after = regionEnd < size && chained(tokenAt(regionEnd)) ? ownerAt(regionEnd) : nullptr;
+    TreeNode* deeper = rightAssociative ? after : before;
+    TreeNode* upper = rightAssociative ? before : after;
+    const int deeperIndex = rightAssociative ? regionEnd : regionBegin - 1;
+
+    // The old region: the unedited tokens around the old ones. Its root is its
+    // weakest operator (the last of equals, the first for '^'), or its only operand or group.
+    auto oldToken = [&](int k) -> const Token& {
+        if (k < first - regionBegin) return tokenAt(regionBegin + k);
+        k -= first - regionBegin;
+        return k < oldCount ? oldTokens[k] : tokenAt(first + count + k - oldCount);
+    };
+    auto oldOwner = [&](int k) -> TreeNode* {
+        if (k < first - regionBegin) return ownerAt(regionBegin + k);
+        k -= first - regionBegin;
+        return k < oldCount ? oldOwners[k] : ownerAt(first + count + k - oldCount);
+    };
+    int rootIndex = 0;
+    int rootPrecedence = NoOperator;
+    forEachTopOperator(oldSize, oldToken, [&](int k, const Token& token) {
+        const int precedence = ExpressionTree::precedence(token.op);
+        if (precedence < rootPrecedence || (precedence == rootPrecedence && token.op != OpCode::Power)) {
+            rootIndex = k;
+            rootPrecedence = precedence;
+        }
+    });
+    TreeNode* oldRoot = oldOwner(rootIndex);
+
+    // Chain link of the old and new region next to the deeper neighbour, if any.
+    // Only edited tokens can be links: unedited ones in the region bind tighter.
+    auto deepestLink = [&](int tokenCount, auto at) {
+        int found = -1;
+        forEachTopOperator(tokenCount, at, [&](int k, const Token& token) {
+            if (chained(token) && (found < 0 || rightAssociative)) found = k;
+        });
+        return found;
+    };
+    const int oldLink = deepestLink(oldCount, [&](int k) -> const Token& { return oldTokens[k]; });
+    TreeNode* oldFirst = oldLink >= 0 ? oldOwners[oldLink] : nullptr;
+
+    // Parse the region where the gaps cannot split it.
+    moveTokenGap(regionEnd);
+    moveTextGap(regionEnd < size ? offsetOf(regionEnd) : textLength());
+    std::vector<TreeNode*> saved(owners.begin() + regionBegin, owners.begin() + regionEnd);
+    TreeNode* parsed = tree.parseInfixRange(tokens, regionBegin, regionEnd, &owners);
+    if (!parsed) {
+        std::copy(saved.begin(), saved.end(), owners.begin() + regionBegin);
+        return false;
+    }
+    const int newLink = deepestLink(regionEnd - regionBegin,
+                                    [&](int k) -> const Token& { return tokens.tokens[regionBegin + k]; });
+    TreeNode* newFirst = newLink >= 0 ? owners[regionBegin + newLink] : nullptr;
+
+    // down() follows the chain towards its deeper end, across() leads to a link's own operand.
+    auto down = [&](TreeNode* node) -> TreeNode*& { return rightAssociative ? node->right : node->left; };
+    auto across = [&](TreeNode* node) -> TreeNode*& { return rightAssociative ? node->left : node->right; };
+
+    // Unhook the old region from the deeper neighbour.
+    TreeNode* oldEdge = nullptr;  // Old operand hanging off the deeper neighbour
+    TreeNode* oldRest = oldRoot;  // Rest of the old region
+    if (deeper) {
+        oldEdge = across(deeper);
+        across(deeper) = nullptr;
+        if (oldFirst) {
+            down(oldFirst) = nullptr;
+        } else {
+            oldRest = nullptr;
+        }
+    }
+    TreeNode* oldTop = oldRest ? oldRest : deeper;
+
+    // Hook the new region on.
+    TreeNode* newTop = parsed;
+    if (deeper) {
+        if (newFirst) {
+            across(deeper) = down(newFirst);
+            down(newFirst) = deeper;
+        } else {
+            across(deeper) = parsed;
+            newTop = deeper;
+        }
+    }
+    tree.deleteTree(oldEdge);
+    if (upper) {
+        down(upper) = newTop;
+        tree.deleteTree(oldRest);
+    } else if (newTop != oldTop) {
+        if (oldRest) {
+            tree.deleteTree(oldTop->left);
+            tree.deleteTree(oldTop->right);
+            tree.dropSpelling(oldTop);
+        } else {
+            // The old top is the deeper neighbour, which stays below the new top.
+            TreeNode* moved = tree.arena.create(std::move(*deeper));
+            down(newFirst) = moved;
+            ownerAt(deeperIndex) = moved;
+        }
+        *oldTop = std::move(*newTop);
+        newTop->left = nullptr;
+        newTop->right = nullptr;
+        tree.arena.destroy(newTop);
+        for (int i = regionBegin; i < regionEnd; ++i) {
+            if (owners[i] == newTop) owners[i] = oldTop;
+        }
+        if (deeper && ownerAt(deeperIndex) == newTop) ownerAt(deeperIndex) = oldTop;
+    }
+    reparsed = regionEnd - regionBegin;
+    return true;
+}
+
+// Parses a whole new expression, with the errors of buildTreeFromInfix(const TokenList&)
+TreeNode* IncrementalParser::parse(std::string_view expression) {
+    closeGaps();
+    TokenList previous;
+    std::swap(tokens, previous);
+    int previousOperators = operatorCount;
+    tree.tokenize(expression, tokens);
+    operatorCount = countOperators(tokens.tokens.data(), tokens.tokens.data() + tokens.tokens.size());
+    textGap = tokens.source.size();
+    tokenGap = tokenCount();
+
+    TreeNode* parsed = reparseAll();
+    if (!parsed) {
+        try {
+            throwInfixError(tree, tokens);
+        } catch (...) {
+            std::swap(tokens, previous);
+            operatorCount = previousOperators;
+            textGap = tokens.source.size();
+            tokenGap = tokenCount();
+            throw;
+        }
+    }
+    tree.deleteTree(root);
+    root = parsed;
+    return root;
+}
+
+// Replaces length characters at offset with replacement and updates the tree.
+TreeNode* IncrementalParser::edit(size_t offset, size_t length, std::string_view replacement) {
+    const size_t oldLength = textLength();
+    if (offset > oldLength || length > oldLength - offset) {
+        throw std::out_of_range("Edit outside the expression");
+    }
+    const size_t newLength = oldLength - length + replacement.size();
+
+    // Re-lex between the nearest restart points around the edit. Both ends lie
+    // next to unedited characters, so every token outside keeps its meaning.
+    auto editedChar = [&](size_t position) {
+        if (position < offset) return charAt(position);
+        if (position < offset + replacement.size()) return replacement[position - offset];
+        return charAt(position - replacement.size() + length);
+    };
+    size_t begin = offset;
+    while (begin > 0 && !Lexer::isRestartAfter(charAt(begin - 1))) --begin;
+    size_t end = std::min(offset + replacement.size() + 1, newLength);
+    while (end < newLength && !Lexer::isRestartAfter(editedChar(end - 1))) ++end;
+    const size_t oldEnd = end - replacement.size() + length;
+
+    auto lowerBound = [&](uint64_t position) {
+        int low = 0;
+        int high = tokenCount();
+        while (low < high) {
+            int middle = low + (high - low) / 2;
+            if (offsetOf(middle) < position) low = middle + 1; else high = middle;
+        }
+        return low;
+    };
+    const int first = lowerBound(begin);
+    const int last = lowerBound(oldEnd);
+
+    // Take the old tokens out, keeping them to undo the edit. With the gap after them,
+    // every later token counts its offset from the end, which the text edit keeps.
+    moveTokenGap(last);
+    std::vector<Token> oldTokens(tokens.tokens.begin() + first, tokens.tokens.begin() + last);
+    std::vector<TreeNode*> oldOwners(owners.begin() + first, owners.begin() + last);
+    tokenGap = first;
+    tokenGapSize += last - first;
+
+    // Replace the text at the text gap, then open [0, end) for the lexer.
+    moveTextGap(offset);
+    std::string removed = tokens.source.substr(textGap + textGapSize, length);
+    textGapSize += length;
+    reserveTextGap(replacement.size());
+    std::copy(replacement.begin(), replacement.end(), tokens.source.begin() + static_cast<std::ptrdiff_t>(textGap));
+    textGap += replacement.size();
+    textGapSize -= replacement.size();
+    moveTextGap(end);
+
+    std::vector<Token> fresh;
+    Lexer lexer(std::string_view(tokens.source).substr(begin, end - begin), tree.symbols);
+    Token token;
+    while (lexer.next(token)) {
+        token.offset += begin;
+        fresh.push_back(token);
+    }
+    const int count = static_cast<int>(fresh.size());
+    reserveTokenGap(count);
+    std::copy(fresh.begin(), fresh.end(), tokens.tokens.begin() + tokenGap);
+    std::fill(owners.begin() + tokenGap, owners.begin() + tokenGap + count, nullptr);
+    tokenGap += count;
+    tokenGapSize -= count;
+    const int previousOperators = operatorCount;
+    operatorCount += countOperators(fresh.data(), fresh.data() + fresh.size()) -
+                     countOperators(oldTokens.data(), oldTokens.data() + oldTokens.size());
+
+    // Same shape: update the nodes in place.
+    bool sameShape = fresh.size() == oldTokens.size();
+    for (size_t k = 0; sameShape && k < fresh.size(); ++k) sameShape = canReplace(oldTokens[k], fresh[k]);
+    if (sameShape) {
+        const uint64_t textShift = tree.keepSpellings(tokens, first, first + count);
+        for (int k = 0; k < count; ++k) {
+            owners[first + k] = oldOwners[k];
+            const Token& replaced = tokens.tokens[first + k];
+            if (replaced.kind == TokenKind::LeftParen || replaced.kind == TokenKind::RightParen) continue;
+            TreeNode updated(replaced, textShift);
+            TreeNode* node = oldOwners[k];
+            tree.dropSpelling(node);
+            node->kind = updated.kind;
+            node->op = updated.op;
+            node->symbol = updated.symbol;
+            node->number = updated.number;
+        }
+        reparsed = 0;
+        return root;
+    }
+
+    // Reparse the region around the edit if the edit keeps the groups apart from it.
+    if (operatorCount > 0 && balancedTokens(fresh.data(), fresh.data() + fresh.size()) &&
+        balancedTokens(oldTokens.data(), oldTokens.data() + oldTokens.size()) &&
+        reparseRegion(first, count, oldTokens, oldOwners)) {
+        return root;
+    }
+
+    // Otherwise reparse everything.
+    TreeNode* parsed = reparseAll();
+    if (parsed) {
+        tree.deleteTree(root);
+        root = parsed;
+        return root;
+    }
+
+    // Invalid: undo the edit and report the error for the edited text.
+    try {
+        throwInfixError(tree, tokens);
+    } catch (...) {
+        moveTokenGap(first + count);
+        tokenGap = first;
+        tokenGapSize += count;
+        reserveTokenGap(static_cast<int>(oldTokens.size()));
+        std::copy(oldTokens.begin(), oldTokens.end(), tokens.tokens.begin() + first);
+        std::copy(oldOwners.begin(), oldOwners.end(), owners.begin() + first);
+        tokenGap += static_cast<int>(oldTokens.size());
+        tokenGapSize -= static_cast<int>(oldTokens.size());
+
+        moveTextGap(offset + replacement.size());
+        textGap = offset;
+        textGapSize += replacement.size();
+        reserveTextGap(length);
+        std::copy(removed.begin(), removed.end(), tokens.source.begin() + static_cast<std::ptrdiff_t>(textGap));
+        textGap += length;
+        textGapSize -= length;
+        operatorCount = previousOperators;
+        throw;
+    }
+}
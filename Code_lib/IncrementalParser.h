@@ -0,0 +1,89 @@
+#ifndef INCREMENTAL_PARSER_H
+#define INCREMENTAL_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ExpressionTree.h"
+#include "Token.h"
+
+/*
+ * IncrementalParser class: Keeps an infix expression, its tokens and its tree
+ * in step while the text is edited.
+ * An edit re-lexes only the text between the nearest points where the lexer
+ * can restart, then does the least reparsing that keeps the tree correct:
+ *  - if every new token can take the place of the old one (operand for operand,
+ *    operator for operator of the same precedence) the nodes are updated in place;
+ *  - otherwise only the region around the edit is reparsed: the span, inside the
+ *    innermost group, between the nearest operators that bind no tighter than the
+ *    weakest operator the edit touches. Its tree is spliced into the chain of
+ *    operators of that precedence it belongs to, so appending " + Z" to a long sum
+ *    parses three tokens. Nodes outside the region keep their addresses;
+ *  - edits that unbalance parentheses reparse the whole expression.
+ * The text, the tokens and their nodes are kept with a gap at the last edit (tokens
+ * after the gap count their offset from the end of the text), so an edit moves only
+ * what lies between it and the previous one, and the work grows with the size of the
+ * edit and of the region around it, not of the expression. Reading text() or
+ * getTokens() closes the gaps, which costs one pass over the expression.
+ * The tree is owned by the parser and freed by it.
+ */
+class IncrementalParser {
+private:
+    ExpressionTree& tree;                                   // Provides the symbol table and node helpers
+    mutable TokenList tokens;                               // Text and tokens, each with a gap
+    mutable std::vector<ExpressionTree::TreeNode*> owners;  // Node of every token (group root for parentheses), gapped like the tokens
+    mutable size_t textGap;       // Start of the gap in tokens.source
+    mutable size_t textGapSize;
+    mutable int tokenGap;         // Start of the gap in tokens.tokens and owners
+    mutable int tokenGapSize;
+    ExpressionTree::TreeNode* root;
+    int operatorCount;                             // Operator tokens in the expression
+    int reparsed;                                  // Tokens parsed by the last call
+
+    // Sizes and positions without the gaps
+    size_t textLength() const { return tokens.source.size() - textGapSize; }
+    int tokenCount() const { return static_cast<int>(tokens.tokens.size()) - tokenGapSize; }
+    int physical(int index) const { return index < tokenGap ? index : index + tokenGapSize; }
+    const Token& tokenAt(int index) const { return tokens.tokens[physical(index)]; }
+    ExpressionTree::TreeNode*& ownerAt(int index) { return owners[physical(index)]; }
+    uint64_t offsetOf(int index) const;
+    char charAt(size_t position) const;
+
+    // Gap handling
+    void moveTextGap(size_t position) const;
+    void moveTokenGap(int index) const;
+    void reserveTextGap(size_t count);
+    void reserveTokenGap(int count);
+    void closeGaps() const;
+
+    ExpressionTree::TreeNode* reparseAll();
+    bool reparseRegion(int first, int count, const std::vector<Token>& oldTokens,
+                       const std::vector<ExpressionTree::TreeNode*>& oldOwners);
+
+public:
+    // Constructor : Starts with no expression; nodes and names go through the given tree
+    explicit IncrementalParser(ExpressionTree& expressionTree);
+    // Destructor : Frees the tree
+    ~IncrementalParser();
+    IncrementalParser(const IncrementalParser&) = delete;
+    IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+    // Parses a whole new expression, with the errors of buildTreeFromInfix(const TokenList&)
+    ExpressionTree::TreeNode* parse(std::string_view expression);
+
+    /*
+     * Replaces length characters at offset with replacement and updates the tree.
+     * Returns the root, whose address only changes when the whole expression was
+     * reparsed. If the edited text is not a valid infix expression the edit is
+     * undone, the tree is left as it was and the error is thrown.
+     */
+    ExpressionTree::TreeNode* edit(size_t offset, size_t length, std::string_view replacement);
+
+    ExpressionTree::TreeNode* getRoot() const { return root; }
+    const std::string& text() const;
+    const TokenList& getTokens() const;
+    // Returns the number of tokens the last parse or edit had to parse (0 when nodes were patched)
+    int lastReparsedTokens() const { return reparsed; }
+};
+
+#endif // INCREMENTAL_PARSER_H
@@ -0,0 +1,209 @@
+#include "Lexer.h"
+#include "NumberParser.h"
+
+// Character classes used as DFA input symbols.
+enum CharClass : unsigned char {
+    Space, Digit, Alpha, Dot, Operator, Minus, LeftParen, RightParen, Other, End,
+    ClassCount
+};
+
+// DFA states. The two start states differ only in how a '-' is read:
+// after an operand it is always the subtraction operator, otherwise it may
+// begin a negative literal. Whitespace always leads back to StartUnary, so
+// "5 -3" keeps reading -3 as one number, as the space-separated format did.
+enum State : unsigned char {
+    StartUnary, StartBinary, MinusSign, IntPart, DotOnly, FracPart, Name, Invalid,
+    StateCount
+};
+
+// Actions that end a token. Values below StateCount mean "consume and move to that state".
+enum Action : unsigned char {
+    Done = 0x80,   // End of input, no token
+    Single,        // Consume the current character as a one-character token
+    EmitMinus,     // The pending '-' is the subtraction operator
+    EmitNumber,    // The pending characters form a number
+    EmitName,      // The pending characters form a variable name
+    EmitInvalid    // The pending characters form a malformed token
+};
+
+// Builds the 256-entry classification table at compile time.
+// Avoids the locale lookups done by isdigit/isalnum on every character.
+struct CharTable {
+    unsigned char classes[256];
+
+    constexpr CharTable() : classes() {
+        for (int c = 0; c < 256; ++c) classes[c] = Other;
+        classes[static_cast<unsigned char>(' ')] = Space;
+        classes[static_cast<unsigned char>('\t')] = Space;
+        classes[static_cast<unsigned char>('\n')] = Space;
+        classes[static_cast<unsigned char>('\v')] = Space;
+        classes[static_cast<unsigned char>('\f')] = Space;
+        classes[static_cast<unsigned char>('\r')] = Space;
+        for (int c = '0'; c <= '9'; ++c) classes[c] = Digit;
+        for (int c = 'a'; c <= 'z'; ++c) classes[c] = Alpha;
+        for (int c = 'A'; c <= 'Z'; ++c) classes[c] = Alpha;
+        classes[static_cast<unsigned char>('.')] = Dot;
+        classes[static_cast<unsigned char>('+')] = Operator;
+        classes[static_cast<unsigned char>('*')] = Operator;
+        classes[static_cast<unsigned char>('/')] = Operator;
+        classes[static_cast<unsigned char>('%')] = Operator;
+        classes[static_cast<unsigned char>('^')] = Operator;
+        classes[static_cast<unsigned char>('-')] = Minus;
+        classes[static_cast<unsigned char>('(')] = LeftParen;
+        classes[static_cast<unsigned char>(')')] = RightParen;
+    }
+};
+
+static constexpr CharTable charTable;
+
+// Operator code for each character, OpCode::None for non-operators.
+struct OpTable {
+    OpCode codes[256];
+
+    constexpr OpTable() : codes() {
+        for (int c = 0; c < 256; ++c) codes[c] = OpCode::None;
+        codes[static_cast<unsigned char>('+')] = OpCode::Add;
+        codes[static_cast<unsigned char>('-')] = OpCode::Subtract;
+        codes[static_cast<unsigned char>('*')] = OpCode::Multiply;
+        codes[static_cast<unsigned char>('/')] = OpCode::Divide;
+        codes[static_cast<unsigned char>('%')] = OpCode::Modulo;
+        codes[static_cast<unsigned char>('^')] = OpCode::Power;
+    }
+};
+
+static constexpr OpTable opTable;
+
+// Returns the source spelling of an operator ("+", "-", ...), or "" for OpCode::None
+const char* opText(OpCode op) {
+    static const char* const texts[] = {"", "+", "-", "*", "/", "%", "^"};
+    return texts[static_cast<int>(op)];
+}
+
+// Transition table indexed by [state][character class].
+static const unsigned char transitions[StateCount][ClassCount] = {
+    //                 Space        Digit        Alpha        Dot          Operator     Minus        (            )            Other        End
+    /* StartUnary  */ {StartUnary,  IntPart,     Name,        DotOnly,     Single,      MinusSign,   Single,      Single,      Invalid,     Done},
+    /* StartBinary */ {StartUnary,  IntPart,     Name,        DotOnly,     Single,      Single,      Single,      Single,      Invalid,     Done},
+    /* MinusSign   */ {EmitMinus,   IntPart,     EmitMinus,   DotOnly,     EmitMinus,   EmitMinus,   EmitMinus,   EmitMinus,   EmitMinus,   EmitMinus},
+    /* IntPart     */ {EmitNumber,  IntPart,     Invalid,     FracPart,    EmitNumber,  EmitNumber,  EmitNumber,  EmitNumber,  Invalid,     EmitNumber},
+    /* DotOnly     */ {EmitInvalid, FracPart,    Invalid,     Invalid,     EmitInvalid, EmitInvalid, EmitInvalid, EmitInvalid, Invalid,     EmitInvalid},
+    /* FracPart    */ {EmitNumber,  FracPart,    Invalid,     Invalid,     EmitNumber,  EmitNumber,  EmitNumber,  EmitNumber,  Invalid,     EmitNumber},
+    /* Name        */ {EmitName,    Name,        Name,        Invalid,     EmitName,    EmitName,    EmitName,    EmitName,    Invalid,     EmitName},
+    /* Invalid     */ {EmitInvalid, Invalid,     Invalid,     Invalid,     EmitInvalid, EmitInvalid, EmitInvalid, EmitInvalid, Invalid,     EmitInvalid},
+};
+
+// Constructor : Starts lexing at the beginning of the expression
+Lexer::Lexer(std::string_view expression, SymbolTable* symbolTable, const StructuralIndex* structuralIndex)
+    : input(expression), position(0), afterOperand(false), symbols(symbolTable), index(structuralIndex), nextStart(0) {}
+
+// Runs the DFA from the current position until a token is accepted.
+// Each character is looked at once; tokens that end on a delimiter leave
+// the delimiter unread for the next call. The accepting action decides the
+// token kind, so no token is re-examined after it has been scanned.
+bool Lexer::next(Token& token) {
+    const char* text = input.data();
+    const size_t length = input.size();
+    unsigned char state = afterOperand ? StartBinary : StartUnary;
+
+    if (index) {
+        // Starts inside the previous token (the digits of a negative literal) are already consumed.
+        const std::vector<uint32_t>& starts = index->tokenStarts();
+        while (nextStart < starts.size() && starts[nextStart] < position) ++nextStart;
+        if (nextStart == starts.size()) {
+            position = length;  // Only whitespace is left
+            return false;
+        }
+        if (starts[nextStart] > position) {
+            // Everything skipped is whitespace, which puts the DFA back in StartUnary.
+            position = starts[nextStart];
+            state = StartUnary;
+        }
+    }
+    size_t start = position;
+
+    while (true) {
+        unsigned char cls = position < length
+                                ? charTable.classes[static_cast<unsigned char>(text[position])]
+                                : static_cast<unsigned char>(End);
+        unsigned char action = transitions[state][cls];
+
+        if (action < StateCount) {
+            // Still inside a token (or skipping whitespace before one).
+            ++position;
+            if (action == StartUnary) start = position;
+            state = action;
+            continue;
+        }
+        if (action == Done) return false;
+
+        token.op = OpCode::None;
+        token.number = 0;
+        switch (action) {
+            case Single:
+                ++position;
+                if (cls == LeftParen) {
+                    token.kind = TokenKind::LeftParen;
+                } else if (cls == RightParen) {
+                    token.kind = TokenKind::RightParen;
+                } else {
+                    token.kind = TokenKind::Operator;
+                    token.op = opTable.codes[static_cast<unsigned char>(text[start])];
+                }
+                afterOperand = cls == RightParen;
+                break;
+            case EmitMinus:
+                token.kind = TokenKind::Operator;
+                token.op = OpCode::Subtract;
+                afterOperand = false;
+                break;
+            case EmitNumber: {
+                token.kind = TokenKind::Number;
+                NumberParser::parse(text + start, text + position, token.number);
+                afterOperand = true;
+                break;
+            }
+            case EmitName:
+                token.kind = TokenKind::Variable;
+                token.symbol = symbols ? symbols->intern(std::string_view(text + start, position - start))
+                                       : SymbolTable::NoSymbol;
+                afterOperand = true;
+                break;
+            default:
+                // Malformed runs sit where an operand would.
+                token.kind = TokenKind::Invalid;
+                afterOperand = true;
+                break;
+        }
+        token.offset = start;
+        token.length = static_cast<uint32_t>(position - start);
+        return true;
+    }
+}
+
+// Advances to the next token and stores a view of its text in token.
+bool Lexer::next(std::string_view& token) {
+    Token classified;
+    if (!next(classified)) return false;
+    token = input.substr(classified.offset, classified.length);
+    return true;
+}
+
+// Restarts lexing at the beginning of new input, dropping any index.
+void Lexer::restart(std::string_view expression, bool previousWasOperand) {
+    input = expression;
+    position = 0;
+    afterOperand = previousWasOperand;
+    index = nullptr;
+    nextStart = 0;
+}
+
+// Returns true if lexing can start afresh at position without changing any token.
+bool Lexer::isRestartPoint(std::string_view text, size_t position) {
+    return isRestartAfter(text[position - 1]);
+}
+
+// Returns true if lexing can restart right after character c.
+bool Lexer::isRestartAfter(char c) {
+    unsigned char cls = charTable.classes[static_cast<unsigned char>(c)];
+    return cls == Space || cls == Operator || cls == LeftParen;
+}
@@ -0,0 +1,64 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <string_view>
+#include "StructuralIndex.h"
+#include "SymbolTable.h"
+#include "Token.h"
+
+/*
+ * Lexer class: A table-driven DFA tokenizer for expressions.
+ * Splits operators, parentheses, numbers (including negative literals) and
+ * variable names in one pass with no backtracking, so spaces between tokens
+ * are optional. Tokens are handed out as views into the input, so lexing does
+ * no per-token allocation. The input must outlive every view returned.
+ */
+class Lexer {
+private:
+    std::string_view input;  // Expression being tokenized (not owned)
+    size_t position;         // Index of the next unread character
+    bool afterOperand;       // True when the previous token was a number, variable or ')'
+    SymbolTable* symbols;          // Optional table that variable names are interned into
+    const StructuralIndex* index;  // Optional token start positions for the same input
+    size_t nextStart;              // Next unused entry of index->tokenStarts()
+
+public:
+    /*
+     * Constructor : Starts lexing at the beginning of the expression.
+     * When a symbol table is given, variable tokens carry their interned id.
+     * When an index built over the same input is given, whitespace between
+     * tokens is skipped by jumping to the next recorded token start.
+     */
+    explicit Lexer(std::string_view expression, SymbolTable* symbolTable = nullptr,
+                   const StructuralIndex* structuralIndex = nullptr);
+
+    /*
+     * Advances to the next token and classifies it: kind, operator code,
+     * source span and, for numbers, the parsed value. Variable tokens get
+     * their interned id, or SymbolTable::NoSymbol without a table. Malformed runs such as "3.14.5"
+     * or "1x" come back as a single Invalid token so later stages can report
+     * them. Returns false once the input is exhausted.
+     */
+    bool next(Token& token);
+
+    // Advances to the next token and stores a view of its text in token.
+    bool next(std::string_view& token);
+
+    /*
+     * Restarts lexing at the beginning of new input, dropping any index.
+     * previousWasOperand says whether the input continues right after a
+     * number, variable or ')', which decides how a leading '-' is read.
+     */
+    void restart(std::string_view expression, bool previousWasOperand);
+
+    /*
+     * Returns true if lexing can start afresh at position (> 0) without changing
+     * any token: the previous character is whitespace or an operator/'(' that is
+     * always a token of its own, so the DFA is back in its start state either way.
+     */
+    static bool isRestartPoint(std::string_view text, size_t position);
+    // Returns true if lexing can restart right after character c (see isRestartPoint)
+    static bool isRestartAfter(char c);
+};
+
+#endif // LEXER_H
@@ -0,0 +1,171 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * NodeArena class: Bump allocator for tree nodes.
+ * Nodes are carved out of large blocks, so creating one is a pointer increment
+ * instead of a malloc. A destroyed node's slot goes on a free list and is reused
+ * by the next create. Nodes must be trivially destructible, so release() (and the
+ * destructor) frees every node still alive by handing the blocks back whole: one
+ * free per block, however many nodes there were, and no node is visited.
+ * Blocks start small and double up to MaximumBlockBytes, so an arena that only
+ * ever holds a few nodes stays small. createRun() places a whole tree's nodes in
+ * one block of their own, in an order chosen by the caller. A run's slots are not
+ * reused one at a time; its block is freed when its last node is destroyed, so
+ * relaying out trees over and over does not pile up blocks. An arena is not
+ * thread-safe: parallel builders give each task its own and adopt() them into the
+ * tree's arena afterwards.
+ */
+template<typename Node>
+class NodeArena {
+public:
+    static constexpr size_t MaximumBlockBytes = 64 * 1024;
+
+private:
+    static constexpr size_t FirstBlockNodes = 32;
+    static constexpr size_t MaximumBlockNodes =
+        MaximumBlockBytes / sizeof(Node) > FirstBlockNodes ? MaximumBlockBytes / sizeof(Node) : FirstBlockNodes;
+
+    // A released slot; its storage holds the link to the next free slot
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+    static_assert(sizeof(Node) >= sizeof(FreeSlot), "a node must be able to hold a free-list link");
+    static_assert(std::is_trivially_destructible<Node>::value, "nodes are freed without running destructors");
+
+    struct Block {
+        Node* nodes;      // Storage for capacity nodes
+        size_t capacity;
+        size_t used;      // Slots handed out by bumping
+    };
+
+    // A block made by createRun
+    struct Run {
+        size_t capacity;
+        size_t live;      // Nodes of the run not yet destroyed
+    };
+
+    std::vector<Block> blocks;  // The block being bumped is last
+    std::map<Node*, Run> runs;  // Run blocks by address, freed when their last node goes
+    FreeSlot* freeSlots;        // Destroyed nodes waiting for reuse
+    size_t liveCount;           // Nodes created and not destroyed
+    uint64_t releases;          // Times release() has dropped the blocks
+
+    // Starts a new block twice the size of the last one (up to the maximum).
+    void grow() {
+        size_t capacity = blocks.empty() ? FirstBlockNodes : std::min(blocks.back().capacity * 2, MaximumBlockNodes);
+        Node* nodes = static_cast<Node*>(::operator new(capacity * sizeof(Node)));
+        blocks.push_back({nodes, capacity, 0});
+    }
+
+public:
+    // Constructor : Starts empty; the first block is allocated by the first create
+    NodeArena() : freeSlots(nullptr), liveCount(0), releases(0) {}
+    // Destructor : Frees every node and block
+    ~NodeArena() { release(); }
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    // Constructs a node in a free slot, or in the next slot of the current block
+    template<typename... Args>
+    Node* create(Args&&... args) {
+        void* slot;
+        if (freeSlots) {
+            slot = freeSlots;
+            freeSlots = freeSlots->next;
+        } else {
+            if (blocks.empty() || blocks.back().used == blocks.back().capacity) grow();
+            slot = blocks.back().nodes + blocks.back().used++;
+        }
+        Node* node = new (slot) Node(std::forward<Args>(args)...);
+        ++liveCount;
+        return node;
+    }
+
+    // Constructs count nodes side by side in a block of their own, node i from make(i),
+    // and returns the first. The block is freed once every node of the run is destroyed.
+    template<typename Make>
+    Node* createRun(size_t count, Make make) {
+        if (count == 0) return nullptr;
+        Node* nodes = static_cast<Node*>(::operator new(count * sizeof(Node)));
+        Run& run = runs.emplace(nodes, Run{count, 0}).first->second;
+        for (size_t i = 0; i < count; ++i) {
+            new (nodes + i) Node(make(i));
+            ++run.live;
+            ++liveCount;
+        }
+        return nodes;
+    }
+
+    // Destroys a node made by this arena. A slot of a bump block is kept for reuse;
+    // the last node of a run frees the run's block.
+    void destroy(Node* node) {
+        if (!runs.empty()) {
+            // The run holding node, if any, is the last one starting at or before it.
+            typename std::map<Node*, Run>::iterator run = runs.upper_bound(node);
+            if (run != runs.begin()) {
+                --run;
+                if (std::less<Node*>()(node, run->first + run->second.capacity)) {
+                    if (--run->second.live == 0) {
+                        ::operator delete(run->first);
+                        runs.erase(run);
+                    }
+                    --liveCount;
+                    return;
+                }
+            }
+        }
+        FreeSlot* slot = reinterpret_cast<FreeSlot*>(node);
+        slot->next = freeSlots;
+        freeSlots = slot;
+        --liveCount;
+    }
+
+    // Takes over the nodes and blocks of another arena, leaving it empty
+    void adopt(NodeArena& other) {
+        runs.insert(other.runs.begin(), other.runs.end());
+        other.runs.clear();
+        // Keep bumping in our own current block; the other arena's blocks go before it.
+        blocks.insert(blocks.empty() ? blocks.end() : blocks.end() - 1, other.blocks.begin(), other.blocks.end());
+        if (other.freeSlots) {
+            FreeSlot* last = other.freeSlots;
+            while (last->next) last = last->next;
+            last->next = freeSlots;
+            freeSlots = other.freeSlots;
+        }
+        liveCount += other.liveCount;
+        other.blocks.clear();
+        other.freeSlots = nullptr;
+        other.liveCount = 0;
+    }
+
+    // Frees every node at once by handing back the blocks
+    void release() {
+        for (Block& block : blocks) ::operator delete(block.nodes);
+        for (std::pair<Node* const, Run>& run : runs) ::operator delete(run.first);
+        blocks.clear();
+        runs.clear();
+        freeSlots = nullptr;
+        liveCount = 0;
+        ++releases;
+    }
+
+    // Returns the number of nodes alive
+    size_t size() const { return liveCount; }
+    // Returns the number of blocks held, runs included
+    size_t blockCount() const { return blocks.size() + runs.size(); }
+    // Returns how many times release() has run; nodes made before a release are gone
+    uint64_t releaseCount() const { return releases; }
+};
+
+#endif // NODE_ARENA_H
@@ -0,0 +1,140 @@
+#include "NotationConverter.h"
+#include <stdexcept>
+
+// Orders in which write visits an operator and its operands
+enum WriteOrder { Preorder, Inorder, Postorder };
+
+// Constructor : Validates input with the given tree
+NotationConverter::NotationConverter(ExpressionTree& expressionTree) : tree(expressionTree) {}
+
+// Writes the expression rooted at token root in the given order. children(i) returns the
+// indices of the left and right operands of the operator at token i.
+template<typename Children>
+void NotationConverter::write(const TokenList& tokens, int root, Children children, int order, TokenWriter& writer) {
+    walk.clear();
+    walk.push_back({root, 0});
+    while (!walk.empty()) {
+        std::pair<int, int>& entry = walk.back();
+        const int index = entry.first;
+        const Token& token = tokens[index];
+        if (token.kind != TokenKind::Operator) {
+            writer.write(tokens.text(token));
+            walk.pop_back();
+        } else if (entry.second == 0) {
+            if (order == Preorder) writer.write(tokens.text(token));
+            if (order == Inorder) writer.write("(");
+            entry.second = 1;
+            walk.push_back({children(index).first, 0});
+        } else if (entry.second == 1) {
+            if (order == Inorder) writer.write(tokens.text(token));
+            entry.second = 2;
+            walk.push_back({children(index).second, 0});
+        } else {
+            if (order == Postorder) writer.write(tokens.text(token));
+            if (order == Inorder) writer.write(")");
+            walk.pop_back();
+        }
+    }
+}
+
+// Converts infix tokens to postfix, writing each token as soon as it is known.
+void NotationConverter::infixToPostfix(const TokenList& tokens, TokenWriter& writer) {
+    tree.validateExpressionType(tokens, 1);
+    tree.validateExpressionStructure(tokens);
+    shuntingYard(tokens, false, [&](int index) { writer.write(tokens.text(tokens[index])); });
+}
+
+// Converts infix tokens to prefix. The tokens come out back to front, so they are
+// collected (as indices) before they are written.
+void NotationConverter::infixToPrefix(const TokenList& tokens, TokenWriter& writer) {
+    tree.validateExpressionType(tokens, 1);
+    tree.validateExpressionStructure(tokens);
+    reversed.clear();
+    shuntingYard(tokens, true, [&](int index) { reversed.push_back(index); });
+    for (auto it = reversed.rbegin(); it != reversed.rend(); ++it) writer.write(tokens.text(tokens[*it]));
+}
+
+// Validates postfix tokens and records the first token of the subtree ending at each token.
+// Reads from the left with a stack of subtree starts.
+static void postfixExtents(ExpressionTree& tree, const TokenList& tokens, std::vector<int>& stack,
+                           std::vector<int>& extents) {
+    tree.validateExpressionType(tokens, 3);
+    tree.validatePostfixExpressionStructure(tokens);
+    extents.resize(tokens.getSize());
+    stack.clear();
+    for (int i = 0; i < tokens.getSize(); ++i) {
+        if (tokens[i].kind == TokenKind::Operator) {
+            // The right operand ends at i - 1; the subtree starts where the left one does.
+            stack.pop_back();
+            extents[i] = stack.back();
+        } else {
+            extents[i] = i;
+            stack.push_back(i);
+        }
+    }
+}
+
+// Converts prefix tokens to infix or postfix in one forward pass. An operand completes
+// every pending operator whose left operand is already written, then becomes the left
+// operand of the next one. Structure errors are found in the same pass.
+void NotationConverter::convertPrefix(const TokenList& tokens, int order, TokenWriter& writer) {
+    tree.validateExpressionType(tokens, 2);
+    frames.clear();
+    bool done = false;
+    for (int i = 0; i < tokens.getSize(); ++i) {
+        const Token& token = tokens[i];
+        if (done) throw std::runtime_error("Invalid prefix expression: Incorrect number of operands");
+
+        if (token.kind == TokenKind::Operator) {
+            if (order == Inorder) writer.write("(");
+            frames.push_back({i, false});
+            continue;
+        }
+        if (token.kind != TokenKind::Number && token.kind != TokenKind::Variable) {
+            throw std::runtime_error("Invalid token in prefix expression: " + std::string(tokens.text(token)));
+        }
+        writer.write(tokens.text(token));
+        // Close every operator this operand completes.
+        while (!frames.empty() && frames.back().second) {
+            writer.write(order == Inorder ? std::string_view(")") : tokens.text(tokens[frames.back().first]));
+            frames.pop_back();
+        }
+        if (frames.empty()) {
+            done = true;
+        } else {
+            frames.back().second = true;
+            if (order == Inorder) writer.write(tokens.text(tokens[frames.back().first]));
+        }
+    }
+
+    if (!done) {
+        // The innermost pending operator is the one the right-to-left validator would reject.
+        if (frames.empty()) throw std::runtime_error("Invalid prefix expression: Incorrect number of operands");
+        throw std::runtime_error("Prefix validation error: Insufficient operands for operator '" +
+                                 std::string(tokens.text(tokens[frames.back().first])) + "'");
+    }
+}
+
+// Converts prefix tokens to fully parenthesized infix.
+void NotationConverter::prefixToInfix(const TokenList& tokens, TokenWriter& writer) {
+    convertPrefix(tokens, Inorder, writer);
+}
+
+// Converts prefix tokens to postfix.
+void NotationConverter::prefixToPostfix(const TokenList& tokens, TokenWriter& writer) {
+    convertPrefix(tokens, Postorder, writer);
+}
+
+// Converts postfix tokens to fully parenthesized infix.
+void NotationConverter::postfixToInfix(const TokenList& tokens, TokenWriter& writer) {
+    postfixExtents(tree, tokens, operators, extents);
+    write(tokens, tokens.getSize() - 1, [&](int i) { return std::make_pair(extents[i - 1] - 1, i - 1); },
+          Inorder, writer);
+}
+
+// Converts postfix tokens to prefix.
+void NotationConverter::postfixToPrefix(const TokenList& tokens, TokenWriter& writer) {
+    postfixExtents(tree, tokens, operators, extents);
+    write(tokens, tokens.getSize() - 1, [&](int i) { return std::make_pair(extents[i - 1] - 1, i - 1); },
+          Preorder, writer);
+}
@@ -0,0 +1,151 @@
+#ifndef NOTATION_CONVERTER_H
+#define NOTATION_CONVERTER_H
+
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "ExpressionTree.h"
+#include "Token.h"
+
+/*
+ * TokenWriter class: Receives the tokens of a converted expression one at a time.
+ */
+class TokenWriter {
+public:
+    virtual ~TokenWriter() = default;
+    // Writes one token
+    virtual void write(std::string_view token) = 0;
+};
+
+/*
+ * StringTokenWriter class: Appends tokens to a string, separated by single spaces,
+ * giving the same text as inorder, preorder and postorder.
+ */
+class StringTokenWriter : public TokenWriter {
+private:
+    std::string& output;
+    bool first;
+
+public:
+    explicit StringTokenWriter(std::string& text) : output(text), first(true) {}
+    void write(std::string_view token) override {
+        if (!first) output += ' ';
+        output += token;
+        first = false;
+    }
+};
+
+/*
+ * StreamTokenWriter class: Writes tokens to an output stream, separated by single spaces.
+ */
+class StreamTokenWriter : public TokenWriter {
+private:
+    std::ostream& output;
+    bool first;
+
+public:
+    explicit StreamTokenWriter(std::ostream& stream) : output(stream), first(true) {}
+    void write(std::string_view token) override {
+        if (!first) output << ' ';
+        output << token;
+        first = false;
+    }
+};
+
+/*
+ * NotationConverter class: Converts between infix, prefix and postfix notation
+ * without building a tree.
+ *  - infix to postfix is a shunting-yard pass; infix to prefix runs it from the
+ *    right and writes the result backwards. Only operators and open parentheses
+ *    are held, one per nesting level.
+ *  - prefix input is converted in one forward pass: each operator waits in a frame
+ *    until its operands are written, so only the pending operators are held.
+ *  - postfix input is first scanned once to find where each operator's subtrees
+ *    start (one int per token), then walked with a stack of one entry per nesting
+ *    level, since its root comes last.
+ * The output is token for token what inorder, preorder and postorder give for the
+ * tree buildTreeFromInfix, buildTreeFromPrefix or buildTreeFromPostfix would build.
+ * Errors carry the validators' messages. Infix and postfix input is checked before
+ * anything is written; prefix input is checked as it is converted, so on an error
+ * the tokens before it have already been written.
+ */
+class NotationConverter {
+private:
+    ExpressionTree& tree;                    // Provides the validators
+    std::vector<int> operators;              // Shunting-yard stack of operator and parenthesis tokens
+    std::vector<int> extents;                // Where the subtree ending at each postfix token starts
+    std::vector<int> reversed;               // Prefix output written back to front
+    std::vector<std::pair<int, int>> walk;   // Token and how much of it is written
+    std::vector<std::pair<int, bool>> frames;  // Pending prefix operator and whether its left operand is written
+
+    template<typename Children>
+    void write(const TokenList& tokens, int root, Children children, int order, TokenWriter& writer);
+    void convertPrefix(const TokenList& tokens, int order, TokenWriter& writer);
+
+public:
+    // Constructor : Validates input with the given tree
+    explicit NotationConverter(ExpressionTree& expressionTree);
+
+    void infixToPostfix(const TokenList& tokens, TokenWriter& writer);
+    void infixToPrefix(const TokenList& tokens, TokenWriter& writer);
+    void prefixToInfix(const TokenList& tokens, TokenWriter& writer);
+    void prefixToPostfix(const TokenList& tokens, TokenWriter& writer);
+    void postfixToInfix(const TokenList& tokens, TokenWriter& writer);
+    void postfixToPrefix(const TokenList& tokens, TokenWriter& writer);
+
+    // Calls emit with the index of every token of valid infix input, in postfix order
+    // (or, with fromRight, in prefix order back to front). Does not validate.
+    template<typename Emit>
+    void shuntingYard(const TokenList& tokens, bool fromRight, Emit emit);
+};
+
+// Runs the shunting-yard algorithm over valid infix tokens, passing the index of each
+// output token to emit. Read from the left it gives postfix; read from the right, with
+// the associativity of each operator mirrored, it gives prefix back to front.
+template<typename Emit>
+void NotationConverter::shuntingYard(const TokenList& tokens, bool fromRight, Emit emit) {
+    const TokenKind open = fromRight ? TokenKind::RightParen : TokenKind::LeftParen;
+    const int size = tokens.getSize();
+    long long operands = 0;  // Values the output would leave on an evaluation stack
+    operators.clear();
+
+    // Writes the operator on top of the stack.
+    auto popOperator = [&]() {
+        if (--operands < 1) throw std::runtime_error("Invalid infix expression");
+        emit(operators.back());
+        operators.pop_back();
+    };
+
+    for (int step = 0; step < size; ++step) {
+        const int i = fromRight ? size - 1 - step : step;
+        const Token& token = tokens[i];
+
+        if (token.kind == TokenKind::Number || token.kind == TokenKind::Variable) {
+            ++operands;
+            emit(i);
+        } else if (token.kind == TokenKind::Operator) {
+            const int power = ExpressionTree::precedence(token.op);
+            // Left-associative operators take equal precedence from the left, ^ from the right.
+            const bool takesEqual = (token.op == OpCode::Power) == fromRight;
+            while (!operators.empty() && tokens[operators.back()].kind == TokenKind::Operator) {
+                const int top = ExpressionTree::precedence(tokens[operators.back()].op);
+                if (top < power || (top == power && !takesEqual)) break;
+                popOperator();
+            }
+            operators.push_back(i);
+        } else if (token.kind == open) {
+            operators.push_back(i);
+        } else {
+            // Closing parenthesis: flush its group.
+            while (tokens[operators.back()].kind == TokenKind::Operator) popOperator();
+            operators.pop_back();
+        }
+    }
+    while (!operators.empty()) popOperator();
+    if (operands != 1) throw std::runtime_error("Invalid infix expression");
+}
+
+#endif // NOTATION_CONVERTER_H
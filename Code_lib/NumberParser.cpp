@@ -0,0 +1,160 @@
+#include "NumberParser.h"
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Exact powers of ten representable as doubles.
+static const double exactPowers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Loads eight bytes as a little-endian integer.
+static inline uint64_t loadEight(const char* bytes) {
+    uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+// True if all eight bytes are ASCII digits.
+static inline bool isEightDigits(uint64_t value) {
+    return (((value & 0xF0F0F0F0F0F0F0F0ULL) |
+             (((value + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+            0x3333333333333333ULL);
+}
+
+// Converts eight ASCII digits to their value with three multiply-and-shift steps.
+static inline uint32_t parseEightDigits(uint64_t value) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 0x000F424000000064ULL;  // 100 + (1000000ULL << 32)
+    const uint64_t mul2 = 0x0000271000000001ULL;  // 1 + (10000ULL << 32)
+    value -= 0x3030303030303030ULL;
+    value = (value * 10) + (value >> 8);           // Pairs of digits
+    value = (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+    return static_cast<uint32_t>(value);
+}
+
+// Accumulates a run of digits into mantissa, eight at a time where possible.
+// Digits past the nineteenth cannot be held exactly; they are counted in dropped.
+static inline const char* accumulateDigits(const char* p, const char* last, uint64_t& mantissa,
+                                           int& digits, int& dropped) {
+    while (last - p >= 8 && digits <= 11) {
+        uint64_t chunk = loadEight(p);
+        if (!isEightDigits(chunk)) break;
+        mantissa = mantissa * 100000000ULL + parseEightDigits(chunk);
+        if (mantissa != 0) digits += 8;  // Conservative: may count leading zeros
+        p += 8;
+    }
+    for (; p != last && static_cast<unsigned char>(*p - '0') <= 9; ++p) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            if (mantissa != 0 || digits != 0) ++digits;
+        } else {
+            ++dropped;
+        }
+    }
+    return p;
+}
+
+// Parses a number at the start of [first, last) into value.
+// Returns a pointer just past the number, or first if no number starts there.
+const char* NumberParser::parse(const char* first, const char* last, double& value) {
+    const char* p = first;
+    bool negative = p != last && *p == '-';
+    if (negative) ++p;
+
+    uint64_t mantissa = 0;
+    int digits = 0;    // Significant digits held in mantissa
+    int dropped = 0;   // Integer digits that did not fit
+
+    const char* integerStart = p;
+    p = accumulateDigits(p, last, mantissa, digits, dropped);
+    size_t integerLength = static_cast<size_t>(p - integerStart);
+    int64_t exponent = dropped;
+
+    size_t fractionLength = 0;
+    if (p != last && *p == '.') {
+        ++p;
+        const char* fractionStart = p;
+        int fractionDropped = 0;
+        p = accumulateDigits(p, last, mantissa, digits, fractionDropped);
+        fractionLength = static_cast<size_t>(p - fractionStart);
+        // Every fraction digit kept in the mantissa (including leading zeros) scales it down by ten.
+        exponent -= static_cast<int64_t>(fractionLength) - fractionDropped;
+        dropped += fractionDropped;
+    }
+    if (integerLength == 0 && fractionLength == 0) return first;
+
+    if (p != last && (*p == 'e' || *p == 'E')) {
+        const char* exponentStart = p;
+        ++p;
+        bool negativeExponent = false;
+        if (p != last && (*p == '+' || *p == '-')) {
+            negativeExponent = *p == '-';
+            ++p;
+        }
+        if (p == last || static_cast<unsigned char>(*p - '0') > 9) {
+            p = exponentStart;  // "1e" is the number 1 followed by other text
+        } else {
+            int64_t explicitExponent = 0;
+            for (; p != last && static_cast<unsigned char>(*p - '0') <= 9; ++p) {
+                if (explicitExponent < 100000) explicitExponent = explicitExponent * 10 + (*p - '0');
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        }
+    }
+
+    // Exact fast path: the mantissa and the power of ten are both exact doubles,
+    // so one IEEE multiply or divide gives the correctly rounded result.
+    if (dropped == 0 && mantissa <= (1ULL << 53)) {
+        double result = static_cast<double>(mantissa);
+        bool exact = true;
+        if (mantissa == 0) {
+            // Zero whatever the exponent
+        } else if (exponent >= 0 && exponent <= 22) {
+            result *= exactPowers[exponent];
+        } else if (exponent < 0 && exponent >= -22) {
+            result /= exactPowers[-exponent];
+        } else if (exponent > 22 && exponent <= 22 + 15) {
+            // Move part of the exponent into the mantissa while it stays exact.
+            double scaled = result * exactPowers[exponent - 22];
+            if (scaled <= 9007199254740992.0) {
+                result = scaled * exactPowers[22];
+            } else {
+                exact = false;
+            }
+        } else {
+            exact = false;
+        }
+        if (exact) {
+            value = negative ? -result : result;
+            return p;
+        }
+    }
+
+    // Everything else (long mantissas, large exponents, subnormals) goes through
+    // the standard library, which is also correctly rounded.
+    std::from_chars_result result = std::from_chars(first, p, value);
+    if (result.ec == std::errc::result_out_of_range) {
+        // Overflow gives infinity, underflow gives zero, as strtod does.
+        bool overflow = exponent + digits > 0;
+        double magnitude = overflow ? std::numeric_limits<double>::infinity() : 0.0;
+        value = negative ? -magnitude : magnitude;
+    }
+    return p;
+}
+
+// Parses text that must consist of exactly one number. Returns false otherwise.
+bool NumberParser::parse(std::string_view text, double& value) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    double parsed;
+    const char* end = parse(first, last, parsed);
+    if (end == first || end != last) return false;
+    value = parsed;
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef NUMBER_PARSER_H
+#define NUMBER_PARSER_H
+
+#include <string_view>
+
+/*
+ * NumberParser class: Fast, correctly rounded decimal-to-double conversion.
+ * Digits are accumulated eight at a time with SWAR arithmetic (SIMD within a
+ * 64-bit register). Values whose digits and exponent fit the exact fast path
+ * are finished with a single multiply or divide; the rest go to std::from_chars.
+ * Accepts [-]digits[.digits][(e|E)[+|-]digits], with digits on at least one
+ * side of the decimal point.
+ */
+class NumberParser {
+public:
+    /*
+     * Parses a number at the start of [first, last) into value.
+     * Returns a pointer just past the number, or first if no number starts there.
+     */
+    static const char* parse(const char* first, const char* last, double& value);
+
+    // Parses text that must consist of exactly one number. Returns false otherwise.
+    static bool parse(std::string_view text, double& value);
+};
+
+#endif // NUMBER_PARSER_H
@@ -0,0 +1,148 @@
+#include "StreamEvaluator.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+// Reads the tokens of a TokenList forwards, or backwards for prefix input.
+class TokenListSource {
+private:
+    const TokenList& tokens;
+    int position;
+    bool reverse;
+
+public:
+    TokenListSource(const TokenList& tokenList, bool backwards)
+        : tokens(tokenList), position(backwards ? tokenList.getSize() - 1 : 0), reverse(backwards) {}
+
+    bool next(Token& token) {
+        if (position < 0 || position >= tokens.getSize()) return false;
+        token = tokens[position];
+        position += reverse ? -1 : 1;
+        return true;
+    }
+
+    std::string_view text(const Token& token) const { return tokens.text(token); }
+};
+
+// Reads the tokens of a StreamLexer.
+class LexerSource {
+private:
+    StreamLexer& lexer;
+
+public:
+    explicit LexerSource(StreamLexer& streamLexer) : lexer(streamLexer) {}
+
+    bool next(Token& token) { return lexer.next(token); }
+
+    std::string_view text(const Token&) const { return lexer.text(); }
+};
+
+// Constructor : Looks variables up in the given bindings
+StreamEvaluator::StreamEvaluator(const VariableBindings& variableValues) : bindings(variableValues) {}
+
+// Returns the value of a number or variable token.
+double StreamEvaluator::operandValue(const Token& token, std::string_view text) const {
+    if (token.kind == TokenKind::Number) return token.number;
+    const double* value = bindings.find(token.symbol);
+    if (!value) throw std::runtime_error("Undefined variable: " + std::string(text));
+    return *value;
+}
+
+// Evaluates postfix tokens read left to right, or prefix tokens read right to left,
+// with a stack of operand values. For prefix input the first value popped is the left operand.
+template<typename Source>
+double StreamEvaluator::evaluatePolish(Source& source, bool prefix) {
+    const std::string notation = prefix ? "prefix" : "postfix";
+    values.clear();
+    Token token;
+
+    while (source.next(token)) {
+        if (token.kind == TokenKind::Number || token.kind == TokenKind::Variable) {
+            values.push_back(operandValue(token, source.text(token)));
+        } else if (token.kind == TokenKind::Operator) {
+            if (values.size() < 2) {
+                throw std::runtime_error(std::string(prefix ? "Prefix" : "Postfix") +
+                                         " validation error: Insufficient operands for operator '" +
+                                         std::string(source.text(token)) + "'");
+            }
+            double first = values.back();
+            values.pop_back();
+            double& second = values.back();
+            second = prefix ? applyOperator(token.op, first, second) : applyOperator(token.op, second, first);
+        } else {
+            throw std::runtime_error("Invalid token in " + notation + " expression: " + std::string(source.text(token)));
+        }
+    }
+
+    // Exactly one value (the result) should remain.
+    if (values.size() != 1) {
+        throw std::runtime_error("Invalid " + notation + " expression: Incorrect number of operands");
+    }
+    return values.back();
+}
+
+// Evaluates prefix tokens read left to right. Each operator becomes a frame; an operand
+// fills the left slot of the innermost frame, or completes it and is folded outwards.
+template<typename Source>
+double StreamEvaluator::evaluatePrefixForward(Source& source) {
+    frames.clear();
+    bool done = false;
+    double result = 0;
+    Token token;
+
+    while (source.next(token)) {
+        if (done) throw std::runtime_error("Invalid prefix expression: Incorrect number of operands");
+
+        if (token.kind == TokenKind::Operator) {
+            frames.push_back({token.op, false, 0});
+        } else if (token.kind == TokenKind::Number || token.kind == TokenKind::Variable) {
+            double value = operandValue(token, source.text(token));
+            // Fold every frame this operand completes.
+            while (!frames.empty() && frames.back().hasLeft) {
+                value = applyOperator(frames.back().op, frames.back().left, value);
+                frames.pop_back();
+            }
+            if (frames.empty()) {
+                result = value;
+                done = true;
+            } else {
+                frames.back().hasLeft = true;
+                frames.back().left = value;
+            }
+        } else {
+            throw std::runtime_error("Invalid token in prefix expression: " + std::string(source.text(token)));
+        }
+    }
+
+    if (!done) {
+        // The innermost pending operator is the one the right-to-left reading would reject.
+        if (frames.empty()) throw std::runtime_error("Invalid prefix expression: Incorrect number of operands");
+        throw std::runtime_error("Prefix validation error: Insufficient operands for operator '" +
+                                 std::string(opText(frames.back().op)) + "'");
+    }
+    return result;
+}
+
+// Evaluates a postfix expression
+double StreamEvaluator::evaluatePostfix(const TokenList& tokens) {
+    TokenListSource source(tokens, false);
+    return evaluatePolish(source, false);
+}
+
+// Evaluates a prefix expression, reading it from the right
+double StreamEvaluator::evaluatePrefix(const TokenList& tokens) {
+    TokenListSource source(tokens, true);
+    return evaluatePolish(source, true);
+}
+
+// Evaluates a postfix expression as it is read from the lexer
+double StreamEvaluator::evaluatePostfix(StreamLexer& lexer) {
+    LexerSource source(lexer);
+    return evaluatePolish(source, false);
+}
+
+// Evaluates a prefix expression as it is read from the lexer
+double StreamEvaluator::evaluatePrefix(StreamLexer& lexer) {
+    LexerSource source(lexer);
+    return evaluatePrefixForward(source);
+}
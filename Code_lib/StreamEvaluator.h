@@ -0,0 +1,55 @@
+#ifndef STREAM_EVALUATOR_H
+#define STREAM_EVALUATOR_H
+
+#include <string_view>
+#include <vector>
+#include "StreamLexer.h"
+#include "SymbolTable.h"
+#include "Token.h"
+
+/*
+ * StreamEvaluator class: Evaluates prefix and postfix expressions straight from
+ * their tokens, without building a tree.
+ * Postfix input is read left to right and prefix input right to left, pushing
+ * operand values and folding the top two at each operator. A prefix stream can only
+ * be read left to right, so there each operator waiting for operands is kept as a
+ * small frame and folded as soon as its right operand is known.
+ * Either way memory grows with the nesting depth of the expression, not its length,
+ * and is reused from one call to the next.
+ * Variable tokens must carry symbol ids from the table the bindings were made with.
+ * Errors are raised in reading order, as soon as they are met: an undefined variable
+ * or a division by zero is reported before a structural error further on, so for
+ * malformed input the message can differ from the one the tree builders give.
+ */
+class StreamEvaluator {
+private:
+    // A prefix operator still waiting for one or both operands
+    struct Frame {
+        OpCode op;      // Operator to apply
+        bool hasLeft;   // True once the left operand is known
+        double left;    // Value of the left operand
+    };
+
+    const VariableBindings& bindings;  // Values of the variables, indexed by symbol id
+    std::vector<double> values;        // Operand values not yet consumed
+    std::vector<Frame> frames;         // Pending prefix operators (streamed prefix only)
+
+    double operandValue(const Token& token, std::string_view text) const;
+    template<typename Source> double evaluatePolish(Source& source, bool prefix);
+    template<typename Source> double evaluatePrefixForward(Source& source);
+
+public:
+    // Constructor : Looks variables up in the given bindings
+    explicit StreamEvaluator(const VariableBindings& variableValues);
+
+    // Evaluates a postfix expression
+    double evaluatePostfix(const TokenList& tokens);
+    // Evaluates a prefix expression, reading it from the right
+    double evaluatePrefix(const TokenList& tokens);
+    // Evaluates a postfix expression as it is read from the lexer
+    double evaluatePostfix(StreamLexer& lexer);
+    // Evaluates a prefix expression as it is read from the lexer
+    double evaluatePrefix(StreamLexer& lexer);
+};
+
+#endif // STREAM_EVALUATOR_H
@@ -0,0 +1,106 @@
+#include "StreamLexer.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Returns true for the whitespace characters the lexer skips.
+static inline bool isSpaceChar(char ch) {
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+// Constructor : Tokenizes an input stream
+StreamLexer::StreamLexer(std::istream& input, SymbolTable* symbolTable, size_t chunkSize)
+    : stream(&input), descriptor(-1), symbols(symbolTable), buffer(chunkSize > 0 ? chunkSize : 1), filled(0),
+      bufferOffset(0), endOfInput(false), afterOperand(false), startUnary(true), lastStart(0), lastLength(0),
+      lexer(std::string_view()) {}
+
+// Constructor : Tokenizes a file descriptor opened for reading
+StreamLexer::StreamLexer(int fileDescriptor, SymbolTable* symbolTable, size_t chunkSize)
+    : stream(nullptr), descriptor(fileDescriptor), symbols(symbolTable), buffer(chunkSize > 0 ? chunkSize : 1),
+      filled(0), bufferOffset(0), endOfInput(false), afterOperand(false), startUnary(true), lastStart(0),
+      lastLength(0), lexer(std::string_view()) {}
+
+// Reads up to size bytes from the input; returns 0 only at the end of the input.
+size_t StreamLexer::readSome(char* destination, size_t size) {
+    if (stream) {
+        stream->read(destination, static_cast<std::streamsize>(size));
+        return static_cast<size_t>(stream->gcount());
+    }
+    while (true) {
+#ifdef _WIN32
+        int got = _read(descriptor, destination, static_cast<unsigned int>(size));
+#else
+        ssize_t got = ::read(descriptor, destination, size);
+#endif
+        if (got >= 0) return static_cast<size_t>(got);
+        if (errno != EINTR) throw std::runtime_error(std::string("Read error: ") + std::strerror(errno));
+    }
+}
+
+// Moves buffer[keepFrom, filled) to the front, reads the next chunk after it and
+// restarts the lexer there. The buffer only grows when the kept bytes (one
+// unfinished token) already fill it.
+void StreamLexer::refill(size_t keepFrom, bool unary) {
+    size_t keep = filled - keepFrom;
+    std::memmove(buffer.data(), buffer.data() + keepFrom, keep);
+    bufferOffset += keepFrom;
+    if (keep == buffer.size()) buffer.resize(buffer.size() * 2);
+
+    size_t got = readSome(buffer.data() + keep, buffer.size() - keep);
+    filled = keep + got;
+    if (got == 0 || (stream && !stream->good())) endOfInput = true;
+
+    startUnary = unary;
+    lexer.restart(std::string_view(buffer.data(), filled), !unary);
+}
+
+// Reads the next token.
+// A token that ends exactly at the end of the buffer may continue in the next
+// chunk, so it is not returned; the buffer is refilled starting at that token and
+// the DFA runs over it again with the same context it started in.
+bool StreamLexer::next(Token& token) {
+    while (true) {
+        Token scanned;
+        if (lexer.next(scanned)) {
+            size_t end = scanned.offset + scanned.length;
+            if (end == filled && !endOfInput) {
+                bool unary = scanned.offset == 0 ? startUnary
+                                                 : isSpaceChar(buffer[scanned.offset - 1]) || !afterOperand;
+                refill(scanned.offset, unary);
+                continue;
+            }
+
+            lastStart = scanned.offset;
+            lastLength = scanned.length;
+            if (scanned.kind == TokenKind::Variable) {
+                scanned.symbol = symbols ? symbols->intern(text()) : SymbolTable::NoSymbol;
+            }
+            afterOperand = scanned.kind == TokenKind::Number || scanned.kind == TokenKind::Variable ||
+                           scanned.kind == TokenKind::RightParen || scanned.kind == TokenKind::Invalid;
+            scanned.offset += bufferOffset;
+            token = scanned;
+            return true;
+        }
+
+        // Only whitespace was left in the buffer.
+        if (endOfInput) return false;
+        refill(filled, filled == 0 ? startUnary : true);
+    }
+}
+
+// Reads up to capacity tokens into tokens. Returns how many were read (0 at the end).
+size_t StreamLexer::nextBatch(Token* tokens, size_t capacity) {
+    size_t count = 0;
+    while (count < capacity && next(tokens[count])) ++count;
+    return count;
+}
+
+// Returns the text of the token most recently returned by next
+std::string_view StreamLexer::text() const {
+    return std::string_view(buffer.data() + lastStart, lastLength);
+}
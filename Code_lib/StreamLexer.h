@@ -0,0 +1,55 @@
+#ifndef STREAM_LEXER_H
+#define STREAM_LEXER_H
+
+#include <istream>
+#include <string_view>
+#include <vector>
+#include "Lexer.h"
+#include "SymbolTable.h"
+#include "Token.h"
+
+/*
+ * StreamLexer class: A pull-based tokenizer for expressions too large to hold in memory.
+ * Reads the input in fixed-size chunks from an istream or a file descriptor and
+ * runs the same DFA as Lexer over each chunk. A token cut off by the end of a chunk
+ * is carried over and lexed again once the next chunk is read, so memory stays at
+ * one chunk (or one token, if a single token is longer than a chunk).
+ * Token offsets are positions in the whole stream.
+ */
+class StreamLexer {
+public:
+    static constexpr size_t DefaultChunkSize = 64 * 1024;
+
+    // Constructor : Tokenizes an input stream; variable names are interned into symbolTable if given
+    explicit StreamLexer(std::istream& input, SymbolTable* symbolTable = nullptr,
+                         size_t chunkSize = DefaultChunkSize);
+    // Constructor : Tokenizes a file descriptor opened for reading (not closed by the lexer)
+    explicit StreamLexer(int fileDescriptor, SymbolTable* symbolTable = nullptr,
+                         size_t chunkSize = DefaultChunkSize);
+
+    // Reads the next token. Returns false at the end of the input.
+    bool next(Token& token);
+    // Reads up to capacity tokens into tokens. Returns how many were read (0 at the end).
+    size_t nextBatch(Token* tokens, size_t capacity);
+    // Returns the text of the token most recently returned by next (valid until the next read)
+    std::string_view text() const;
+
+private:
+    std::istream* stream;      // Input stream, or nullptr when reading a descriptor
+    int descriptor;            // Input descriptor when stream is nullptr
+    SymbolTable* symbols;      // Optional table for variable names
+    std::vector<char> buffer;  // Current chunk (plus any carried-over partial token)
+    size_t filled;             // Number of valid bytes in buffer
+    uint64_t bufferOffset;     // Stream position of buffer[0]
+    bool endOfInput;           // True once the input has no more bytes
+    bool afterOperand;         // True if the last token returned was a number, variable or ')'
+    bool startUnary;           // How the lexer was started on the current buffer
+    size_t lastStart;          // Buffer position of the last token returned
+    size_t lastLength;         // Length of the last token returned
+    Lexer lexer;               // DFA over buffer[0, filled)
+
+    size_t readSome(char* destination, size_t size);
+    void refill(size_t keepFrom, bool unary);
+};
+
+#endif // STREAM_LEXER_H
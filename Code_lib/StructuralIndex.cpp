@@ -0,0 +1,237 @@
+#include "StructuralIndex.h"
+#include <cstring>
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define STRUCTURAL_INDEX_X86 1
+#endif
+
+// Class bits for the scalar classifier, one bit per mask in BlockMasks.
+enum ByteClass : unsigned char {
+    OperatorBit = 1,
+    OpenBit = 2,
+    CloseBit = 4,
+    DigitBit = 8,
+    LetterBit = 16,
+    SpaceBit = 32
+};
+
+// Builds the 256-entry byte classification table at compile time.
+struct ByteTable {
+    unsigned char classes[256];
+
+    constexpr ByteTable() : classes() {
+        const char operators[] = "+-*/%^";
+        for (int i = 0; i < 6; ++i) classes[static_cast<unsigned char>(operators[i])] = OperatorBit;
+        classes[static_cast<unsigned char>('(')] = OpenBit;
+        classes[static_cast<unsigned char>(')')] = CloseBit;
+        for (int c = '0'; c <= '9'; ++c) classes[c] = DigitBit;
+        classes[static_cast<unsigned char>('.')] = DigitBit;
+        for (int c = 'a'; c <= 'z'; ++c) classes[c] = LetterBit;
+        for (int c = 'A'; c <= 'Z'; ++c) classes[c] = LetterBit;
+        classes[static_cast<unsigned char>(' ')] = SpaceBit;
+        for (int c = '\t'; c <= '\r'; ++c) classes[c] = SpaceBit;
+    }
+};
+
+static constexpr ByteTable byteTable;
+
+// Portable bit helpers.
+static inline int trailingZeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int count = 0;
+    while (!(bits & 1)) { bits >>= 1; ++count; }
+    return count;
+#endif
+}
+
+static inline int64_t popCount(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(bits);
+#else
+    int64_t count = 0;
+    for (; bits; bits &= bits - 1) ++count;
+    return count;
+#endif
+}
+
+// Scalar fallback: one table lookup per byte, folded into the masks without branches.
+static StructuralIndex::BlockMasks classifyScalar(const char* block) {
+    StructuralIndex::BlockMasks masks = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 64; ++i) {
+        uint64_t cls = byteTable.classes[static_cast<unsigned char>(block[i])];
+        masks.operators |= (cls & 1) << i;
+        masks.open |= ((cls >> 1) & 1) << i;
+        masks.close |= ((cls >> 2) & 1) << i;
+        masks.digits |= ((cls >> 3) & 1) << i;
+        masks.letters |= ((cls >> 4) & 1) << i;
+        masks.spaces |= ((cls >> 5) & 1) << i;
+    }
+    return masks;
+}
+
+#ifdef STRUCTURAL_INDEX_X86
+
+// SSE2: classifies 16 bytes per step, four steps per block.
+__attribute__((target("sse2")))
+static StructuralIndex::BlockMasks classifySse2(const char* block) {
+    StructuralIndex::BlockMasks masks = {0, 0, 0, 0, 0, 0};
+    for (int part = 0; part < 4; ++part) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * part));
+
+        __m128i ops = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('+')), _mm_cmpeq_epi8(x, _mm_set1_epi8('-'))),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('*')), _mm_cmpeq_epi8(x, _mm_set1_epi8('/'))),
+                         _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('%')), _mm_cmpeq_epi8(x, _mm_set1_epi8('^')))));
+        __m128i open = _mm_cmpeq_epi8(x, _mm_set1_epi8('('));
+        __m128i close = _mm_cmpeq_epi8(x, _mm_set1_epi8(')'));
+
+        // Unsigned range checks: (x - low) <= span  <=>  min(x - low, span) == x - low
+        __m128i digit = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+        __m128i digits = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit),
+                                      _mm_cmpeq_epi8(x, _mm_set1_epi8('.')));
+        __m128i letter = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        __m128i letters = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter);
+        __m128i control = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+        __m128i spaces = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control),
+                                      _mm_cmpeq_epi8(x, _mm_set1_epi8(' ')));
+
+        int shift = 16 * part;
+        masks.operators |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(ops))) << shift;
+        masks.open |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(open))) << shift;
+        masks.close |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(close))) << shift;
+        masks.digits |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(digits))) << shift;
+        masks.letters |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(letters))) << shift;
+        masks.spaces |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(spaces))) << shift;
+    }
+    return masks;
+}
+
+// AVX2: classifies 32 bytes per step, two steps per block.
+__attribute__((target("avx2")))
+static StructuralIndex::BlockMasks classifyAvx2(const char* block) {
+    StructuralIndex::BlockMasks masks = {0, 0, 0, 0, 0, 0};
+    for (int part = 0; part < 2; ++part) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * part));
+
+        __m256i ops = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('+')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('-'))),
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('*')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('/'))),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('%')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('^')))));
+        __m256i open = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('('));
+        __m256i close = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(')'));
+
+        __m256i digit = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+        __m256i digits = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit),
+                                         _mm256_cmpeq_epi8(x, _mm256_set1_epi8('.')));
+        __m256i letter = _mm256_sub_epi8(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i letters = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(25)), letter);
+        __m256i control = _mm256_sub_epi8(x, _mm256_set1_epi8('\t'));
+        __m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(control, _mm256_set1_epi8(4)), control),
+                                         _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')));
+
+        int shift = 32 * part;
+        masks.operators |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(ops))) << shift;
+        masks.open |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(open))) << shift;
+        masks.close |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(close))) << shift;
+        masks.digits |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(digits))) << shift;
+        masks.letters |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(letters))) << shift;
+        masks.spaces |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(spaces))) << shift;
+    }
+    return masks;
+}
+
+#endif // STRUCTURAL_INDEX_X86
+
+// Picks the classifier once, based on what the running CPU supports.
+typedef StructuralIndex::BlockMasks (*Classifier)(const char*);
+
+static Classifier selectClassifier() {
+#ifdef STRUCTURAL_INDEX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return classifyAvx2;
+    if (__builtin_cpu_supports("sse2")) return classifySse2;
+#endif
+    return classifyScalar;
+}
+
+static const Classifier classifier = selectClassifier();
+
+// Default constructor : Creates an empty index
+StructuralIndex::StructuralIndex() : balanced(true) {}
+
+// Classifies 64 bytes starting at block using the fastest routine the CPU supports.
+StructuralIndex::BlockMasks StructuralIndex::classify(const char* block) {
+    return classifier(block);
+}
+
+// Indexes the input one 64-byte block at a time.
+// Token starts are operators, parentheses, and the first byte of every run of
+// other non-space bytes; they are extracted from the mask with count-trailing-zeros,
+// so the cost depends on the number of tokens rather than the number of bytes.
+// The parenthesis depth is advanced per block with popcounts, and the bits are
+// only walked one by one when a block could take the depth below zero.
+bool StructuralIndex::build(std::string_view input, bool recordTokenStarts) {
+    starts.clear();
+    balanced = true;
+    if (input.size() >= std::numeric_limits<uint32_t>::max()) return false;
+
+    const char* data = input.data();
+    const size_t length = input.size();
+    uint64_t previousWord = 0;  // 1 if the last byte of the previous block belonged to a word
+    int64_t depth = 0;          // Running parenthesis depth
+
+    for (size_t offset = 0; offset < length; offset += 64) {
+        BlockMasks masks;
+        if (length - offset >= 64) {
+            masks = classifier(data + offset);
+        } else {
+            // Pad the tail with spaces so it adds no tokens and no parentheses.
+            char tail[64];
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, data + offset, length - offset);
+            masks = classifier(tail);
+        }
+
+        if (recordTokenStarts) {
+            uint64_t single = masks.operators | masks.open | masks.close;
+            uint64_t word = ~(single | masks.spaces);
+            uint64_t tokenBits = single | (word & ~((word << 1) | previousWord));
+            previousWord = word >> 63;
+            while (tokenBits) {
+                starts.push_back(static_cast<uint32_t>(offset + trailingZeros(tokenBits)));
+                tokenBits &= tokenBits - 1;
+            }
+        }
+
+        if (!balanced) continue;
+        int64_t closing = popCount(masks.close);
+        if (closing <= depth) {
+            depth += popCount(masks.open) - closing;  // Cannot go below zero in this block
+        } else {
+            for (uint64_t parens = masks.open | masks.close; parens; parens &= parens - 1) {
+                uint64_t bit = parens & (~parens + 1);
+                depth += (masks.open & bit) ? 1 : -1;
+                if (depth < 0) {
+                    balanced = false;
+                    break;
+                }
+            }
+        }
+    }
+    balanced = balanced && depth == 0;
+    return true;
+}
+
+// Positions of every operator, parenthesis and first byte of a number or name, in order
+const std::vector<uint32_t>& StructuralIndex::tokenStarts() const {
+    return starts;
+}
+
+// True if no prefix of the input closes more parentheses than it opens and all are closed
+bool StructuralIndex::balancedParentheses() const {
+    return balanced;
+}
@@ -0,0 +1,55 @@
+#ifndef STRUCTURAL_INDEX_H
+#define STRUCTURAL_INDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/*
+ * StructuralIndex class: A vectorized pre-pass for very large expressions.
+ * Classifies the input 64 bytes at a time into operator, parenthesis, digit,
+ * letter and whitespace bitmasks (AVX2 or SSE2 when available, a table lookup
+ * otherwise). In the same sweep it records every position where a token can
+ * start and checks that parentheses are balanced, so the lexer can jump over
+ * whitespace and the validators do not need to walk the text again.
+ */
+class StructuralIndex {
+public:
+    // Classification of one 64-byte block; bit i describes byte i of the block.
+    struct BlockMasks {
+        uint64_t operators;  // + - * / % ^
+        uint64_t open;       // (
+        uint64_t close;      // )
+        uint64_t digits;     // 0-9 and '.'
+        uint64_t letters;    // a-z, A-Z
+        uint64_t spaces;     // Whitespace
+    };
+
+    // Inputs shorter than this are cheaper to scan directly with the lexer.
+    static constexpr size_t MinimumInputSize = 64 * 1024;
+
+    // Default constructor : Creates an empty index
+    StructuralIndex();
+
+    // Classifies 64 bytes starting at block using the fastest routine the CPU supports.
+    static BlockMasks classify(const char* block);
+
+    /*
+     * Indexes the input in one sweep. When recordTokenStarts is false only the
+     * parenthesis check is done. Returns false if the input is too large for
+     * 32-bit positions, in which case the index is left empty.
+     */
+    bool build(std::string_view input, bool recordTokenStarts = true);
+
+    // Positions of every operator, parenthesis and first byte of a number or name, in order
+    const std::vector<uint32_t>& tokenStarts() const;
+
+    // True if no prefix of the input closes more parentheses than it opens and all are closed
+    bool balancedParentheses() const;
+
+private:
+    std::vector<uint32_t> starts;  // Token start positions
+    bool balanced;                 // Result of the parenthesis check
+};
+
+#endif // STRUCTURAL_INDEX_H
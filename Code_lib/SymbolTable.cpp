@@ -0,0 +1,161 @@
+#include "SymbolTable.h"
+#include <stdexcept>
+
+// Default constructor : Creates an empty table with 64 slots
+SymbolTable::SymbolTable() : count(0) {
+    Table* initial = new Table;
+    initial->mask = 63;
+    initial->slots = new std::atomic<const Entry*>[64];
+    for (size_t i = 0; i <= initial->mask; ++i) initial->slots[i].store(nullptr, std::memory_order_relaxed);
+    table.store(initial, std::memory_order_relaxed);
+    for (int k = 0; k < ChunkCount; ++k) chunks[k].store(nullptr, std::memory_order_relaxed);
+}
+
+// Destructor : Frees all entries and hash tables
+SymbolTable::~SymbolTable() {
+    Table* current = table.load(std::memory_order_relaxed);
+    delete[] current->slots;
+    delete current;
+    for (Table* old : retiredTables) {
+        delete[] old->slots;
+        delete old;
+    }
+    for (int k = 0; k < ChunkCount; ++k) delete[] chunks[k].load(std::memory_order_relaxed);
+}
+
+// FNV-1a hash of a name
+uint32_t SymbolTable::hashName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char ch : name) {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Linear probing: returns the entry for the name, or nullptr on reaching an empty slot.
+// Slots go from null to an entry exactly once, so an acquire load sees a complete entry.
+const SymbolTable::Entry* SymbolTable::probe(const Table* table, std::string_view name, uint32_t hash) {
+    for (size_t slot = hash & table->mask;; slot = (slot + 1) & table->mask) {
+        const Entry* entry = table->slots[slot].load(std::memory_order_acquire);
+        if (!entry) return nullptr;
+        if (entry->hash == hash && entry->name == name) return entry;
+    }
+}
+
+// Index of the highest set bit of a non-zero value.
+static inline int highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+// Maps an id to its chunk and position: chunk k starts at ChunkBase * (2^k - 1).
+const SymbolTable::Entry* SymbolTable::entryAt(uint32_t id) const {
+    uint64_t scaled = static_cast<uint64_t>(id) / ChunkBase + 1;
+    int k = highestBit(scaled);
+    uint64_t first = static_cast<uint64_t>(ChunkBase) * ((1ULL << k) - 1);
+    return chunks[k].load(std::memory_order_acquire) + (id - first);
+}
+
+// Returns the storage for a new id, allocating its chunk if needed (called under writeLock).
+SymbolTable::Entry* SymbolTable::allocateEntry(uint32_t id) {
+    uint64_t scaled = static_cast<uint64_t>(id) / ChunkBase + 1;
+    int k = highestBit(scaled);
+    if (k >= ChunkCount) throw std::length_error("Symbol table is full");
+    Entry* chunk = chunks[k].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Entry[static_cast<size_t>(ChunkBase) << k];
+        chunks[k].store(chunk, std::memory_order_release);
+    }
+    uint64_t first = static_cast<uint64_t>(ChunkBase) * ((1ULL << k) - 1);
+    return chunk + (id - first);
+}
+
+// Doubles the hash table (called under writeLock). The old table stays valid
+// for readers that already loaded it and is freed with the symbol table.
+void SymbolTable::grow() {
+    Table* old = table.load(std::memory_order_relaxed);
+    Table* bigger = new Table;
+    bigger->mask = old->mask * 2 + 1;
+    bigger->slots = new std::atomic<const Entry*>[bigger->mask + 1];
+    for (size_t i = 0; i <= bigger->mask; ++i) bigger->slots[i].store(nullptr, std::memory_order_relaxed);
+
+    for (size_t i = 0; i <= old->mask; ++i) {
+        const Entry* entry = old->slots[i].load(std::memory_order_relaxed);
+        if (!entry) continue;
+        size_t slot = entry->hash & bigger->mask;
+        while (bigger->slots[slot].load(std::memory_order_relaxed)) slot = (slot + 1) & bigger->mask;
+        bigger->slots[slot].store(entry, std::memory_order_relaxed);
+    }
+    retiredTables.push_back(old);
+    table.store(bigger, std::memory_order_release);
+}
+
+// Returns the id of a name, assigning the next free id the first time it is seen.
+// Hits are answered without locking; misses re-check under the lock before inserting.
+uint32_t SymbolTable::intern(std::string_view name) {
+    uint32_t hash = hashName(name);
+    const Entry* found = probe(table.load(std::memory_order_acquire), name, hash);
+    if (found) return found->id;
+
+    std::lock_guard<std::mutex> guard(writeLock);
+    Table* current = table.load(std::memory_order_relaxed);
+    found = probe(current, name, hash);
+    if (found) return found->id;
+
+    uint32_t id = count.load(std::memory_order_relaxed);
+    Entry* entry = allocateEntry(id);
+    entry->name.assign(name.data(), name.size());
+    entry->hash = hash;
+    entry->id = id;
+
+    // Keep the load factor at or below one half.
+    if ((static_cast<size_t>(id) + 1) * 2 > current->mask + 1) {
+        grow();
+        current = table.load(std::memory_order_relaxed);
+    }
+    // Count the entry before publishing it, so any reader that finds it may also call name(id).
+    count.store(id + 1, std::memory_order_release);
+    size_t slot = hash & current->mask;
+    while (current->slots[slot].load(std::memory_order_relaxed)) slot = (slot + 1) & current->mask;
+    current->slots[slot].store(entry, std::memory_order_release);
+    return id;
+}
+
+// Returns the id of a name, or NoSymbol if it was never interned; never locks
+uint32_t SymbolTable::find(std::string_view name) const {
+    const Entry* found = probe(table.load(std::memory_order_acquire), name, hashName(name));
+    return found ? found->id : NoSymbol;
+}
+
+// Returns the name of an id previously returned by intern
+std::string_view SymbolTable::name(uint32_t id) const {
+    if (id >= count.load(std::memory_order_acquire)) throw std::out_of_range("Unknown symbol id");
+    return entryAt(id)->name;
+}
+
+// Returns the number of interned names
+uint32_t SymbolTable::size() const {
+    return count.load(std::memory_order_acquire);
+}
+
+// Sets the value of a variable id, growing the arrays as needed
+void VariableBindings::set(uint32_t id, double value) {
+    if (id >= bound.size()) {
+        values.resize(static_cast<size_t>(id) + 1, 0.0);
+        bound.resize(static_cast<size_t>(id) + 1, 0);
+    }
+    values[id] = value;
+    bound[id] = 1;
+}
+
+// Removes all values
+void VariableBindings::clear() {
+    values.clear();
+    bound.clear();
+}
@@ -0,0 +1,89 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * SymbolTable class: Interns variable names into dense 32-bit ids (0, 1, 2, ...).
+ * Safe to share between parser threads. Looking up a name that is already
+ * interned takes no lock: the hash table is open-addressed with atomic slots
+ * that are only ever filled, never changed. New names are added under a mutex.
+ */
+class SymbolTable {
+public:
+    static constexpr uint32_t NoSymbol = 0xFFFFFFFFu;  // Returned by find for unknown names
+
+    // Default constructor : Creates an empty table
+    SymbolTable();
+    // Destructor : Frees all entries and hash tables
+    ~SymbolTable();
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    // Returns the id of a name, assigning the next free id the first time it is seen
+    uint32_t intern(std::string_view name);
+    // Returns the id of a name, or NoSymbol if it was never interned; never locks
+    uint32_t find(std::string_view name) const;
+    // Returns the name of an id previously returned by intern
+    std::string_view name(uint32_t id) const;
+    // Returns the number of interned names
+    uint32_t size() const;
+
+private:
+    // One interned name. Entries never move once published.
+    struct Entry {
+        std::string name;
+        uint32_t hash;
+        uint32_t id;
+    };
+
+    // Open-addressed table of entry pointers; its capacity is a power of two.
+    struct Table {
+        size_t mask;
+        std::atomic<const Entry*>* slots;
+    };
+
+    // Entries are stored by id in chunks of doubling size, so they never move:
+    // chunk k holds ChunkBase << k entries.
+    static constexpr uint32_t ChunkBase = 64;
+    static constexpr int ChunkCount = 27;
+
+    std::atomic<Table*> table;                 // Current hash table
+    std::vector<Table*> retiredTables;         // Outgrown tables, kept alive for concurrent readers
+    std::atomic<Entry*> chunks[ChunkCount];    // Entry storage by id
+    std::atomic<uint32_t> count;               // Number of interned names
+    std::mutex writeLock;                      // Serialises inserts
+
+    static uint32_t hashName(std::string_view name);
+    static const Entry* probe(const Table* table, std::string_view name, uint32_t hash);
+    const Entry* entryAt(uint32_t id) const;
+    Entry* allocateEntry(uint32_t id);
+    void grow();
+};
+
+/*
+ * VariableBindings class: Variable values indexed by symbol id, so evaluation
+ * looks values up with an array access instead of hashing the name.
+ */
+class VariableBindings {
+private:
+    std::vector<double> values;         // Value of each bound id
+    std::vector<unsigned char> bound;   // 1 if the id has a value
+
+public:
+    // Sets the value of a variable id
+    void set(uint32_t id, double value);
+    // Returns a pointer to the value of an id, or nullptr if it is unbound
+    const double* find(uint32_t id) const {
+        return id < bound.size() && bound[id] ? &values[id] : nullptr;
+    }
+    // Removes all values
+    void clear();
+};
+
+#endif // SYMBOL_TABLE_H
@@ -0,0 +1,93 @@
+#include "ThreadPool.h"
+
+// True on threads that are currently running a pool task.
+static thread_local bool insideTask = false;
+
+// Constructor : Starts threadCount - 1 workers (the caller is the last thread). 0 means one per core.
+ThreadPool::ThreadPool(unsigned threadCount)
+    : task(nullptr), taskCount(0), nextTask(0), busy(0), generation(0), stopping(false) {
+    if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+// Destructor : Stops and joins the workers
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+// Runs tasks of the current batch until none are left.
+void ThreadPool::drain() {
+    insideTask = true;
+    size_t index;
+    while ((index = nextTask.fetch_add(1, std::memory_order_relaxed)) < taskCount) {
+        try {
+            (*task)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+        }
+    }
+    insideTask = false;
+}
+
+// Worker loop: waits for a batch, helps drain it, reports back.
+void ThreadPool::work() {
+    unsigned long long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+        lock.unlock();
+        drain();
+        lock.lock();
+        if (--busy == 0) finished.notify_all();
+    }
+}
+
+// Calls task(i) for every i in [0, count) and waits for all of them.
+void ThreadPool::run(size_t count, const std::function<void(size_t)>& function) {
+    if (count == 0) return;
+    if (insideTask || workers.empty() || count == 1) {
+        // Nested or trivial batches run on the calling thread.
+        for (size_t i = 0; i < count; ++i) function(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(runMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &function;
+        taskCount = count;
+        nextTask.store(0, std::memory_order_relaxed);
+        error = nullptr;
+        busy = workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+    drain();
+
+    std::exception_ptr failure;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return busy == 0; });
+        task = nullptr;
+        failure = error;
+        error = nullptr;
+    }
+    if (failure) std::rethrow_exception(failure);
+}
+
+// Returns a process-wide pool with one thread per core
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
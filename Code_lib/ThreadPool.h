@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * ThreadPool class: A fixed set of worker threads for data-parallel loops.
+ * run(count, task) calls task(0) ... task(count - 1) spread over the workers
+ * and the calling thread, and returns once every call has finished. Calls
+ * made from inside a task run inline, so tasks may use the pool themselves.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;                        // Guards the fields below
+    std::condition_variable wake;            // Signals a new batch or shutdown
+    std::condition_variable finished;        // Signals that every worker left the batch
+    const std::function<void(size_t)>* task; // Task of the current batch
+    size_t taskCount;                        // Number of calls in the current batch
+    std::atomic<size_t> nextTask;            // Next index to hand out
+    size_t busy;                             // Workers still in the current batch
+    unsigned long long generation;           // Incremented for every batch
+    bool stopping;
+    std::exception_ptr error;                // First exception thrown by a task
+    std::mutex runMutex;                     // Serializes batches from different threads
+
+    void work();
+    void drain();
+
+public:
+    // Constructor : Starts threadCount - 1 workers (the caller is the last thread). 0 means one per core.
+    explicit ThreadPool(unsigned threadCount = 0);
+    // Destructor : Stops and joins the workers
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Returns the number of threads that take part in a batch, including the caller
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Calls task(i) for every i in [0, count) and waits for all of them.
+    // The first exception thrown by a task is rethrown here.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+    // Returns a process-wide pool with one thread per core
+    static ThreadPool& shared();
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,87 @@
+#ifndef TOKEN_H
+#define TOKEN_H
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Kinds of tokens produced by the lexer
+enum class TokenKind : uint8_t {
+    Number,      // Numeric literal, e.g. 5, -3.14
+    Variable,    // Variable name, e.g. AX, y1
+    Operator,    // One of + - * / % ^
+    LeftParen,   // (
+    RightParen,  // )
+    Invalid      // Malformed run such as 3.14.5 or 1x
+};
+
+// Binary operator codes
+enum class OpCode : uint8_t {
+    None,      // Not an operator
+    Add,       // +
+    Subtract,  // -
+    Multiply,  // *
+    Divide,    // /
+    Modulo,    // %
+    Power      // ^
+};
+
+// Returns the source spelling of an operator ("+", "-", ...), or "" for OpCode::None
+const char* opText(OpCode op);
+
+// Applies a binary operator, throwing on division or modulo by zero. This is the
+// arithmetic of every evaluator; it is inline so their loops compile it to a jump table.
+inline double applyOperator(OpCode op, double left, double right) {
+    switch (op) {
+        case OpCode::Add: return left + right;
+        case OpCode::Subtract: return left - right;
+        case OpCode::Multiply: return left * right;
+        case OpCode::Divide:
+            if (right == 0) throw std::runtime_error("Division by zero!");
+            return left / right;
+        case OpCode::Modulo:
+            if (right == 0) throw std::runtime_error("Modulo by zero!");
+            return std::fmod(left, right);
+        case OpCode::Power: return std::pow(left, right);
+        default:
+            throw std::runtime_error("Invalid operator!"); // Handle unexpected operators.
+    }
+}
+
+/*
+ * Token struct: One classified token, produced once by the lexer so later
+ * stages never have to look at its characters again.
+ */
+struct Token {
+    TokenKind kind;    // What the token is
+    OpCode op;         // Operator code (OpCode::None unless kind is Operator)
+    uint32_t length;   // Length of the token in the source
+    uint64_t offset;   // Position of the token in the source
+    union {
+        double number;    // Parsed value when kind is Number
+        uint32_t symbol;  // Interned variable id when kind is Variable
+    };
+};
+
+/*
+ * TokenList struct: The tokens of one expression together with the text
+ * their spans point into.
+ */
+struct TokenList {
+    std::string source;         // Text the token offsets refer to
+    std::vector<Token> tokens;  // Tokens in source order
+
+    // Returns the number of tokens
+    int getSize() const { return static_cast<int>(tokens.size()); }
+    // Provides unchecked access to a token by index
+    const Token& operator[](int index) const { return tokens[index]; }
+    // Returns the source text of a token
+    std::string_view text(const Token& token) const {
+        return std::string_view(source).substr(token.offset, token.length);
+    }
+};
+
+#endif // TOKEN_H
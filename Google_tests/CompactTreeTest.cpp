@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include "CompactTree.h"
+#include "ExpressionTree.h"
+#include "TestExpressions.h"
+
+class CompactTreeTest : public ::testing::Test {
+protected:
+    ExpressionTree expressionTree;
+    VariableBindings bindings;
+
+    void SetUp() override { bindTestVariables(expressionTree, bindings); }
+};
+
+// Test the pre-order layout and the child indices
+TEST_F(CompactTreeTest, Layout) {
+    CompactTree compact;
+    compact.assign(expressionTree, expressionTree.buildTreeFromInfix(std::string("( A + 2 ) * C")).get());
+
+    ASSERT_EQ(compact.size(), 5u);
+    EXPECT_EQ(compact[0].tag, NodeTag::Multiply);
+    EXPECT_EQ(compact[0].left, 1u);
+    EXPECT_EQ(compact[0].right, 4u);
+    EXPECT_EQ(compact[1].tag, NodeTag::Add);
+    EXPECT_EQ(compact[1].left, 2u);
+    EXPECT_EQ(compact[1].right, 3u);
+    EXPECT_EQ(compact[2].tag, NodeTag::Variable);
+    EXPECT_EQ(compact[2].left, expressionTree.symbols->find("A"));
+    EXPECT_EQ(compact[3].tag, NodeTag::Number);
+    EXPECT_EQ(compact[3].number, 2.0);
+    EXPECT_DOUBLE_EQ(compact.evaluate(bindings), 24.5);
+}
+
+// Test that evaluation matches the pointer tree, errors included
+TEST_F(CompactTreeTest, MatchesTreeEvaluation) {
+    ExpressionGenerator generator(9, {"+", "-", "*", "/", "^"}, {"A", "B", "C", "0.5", "3"});
+    CompactTree compact;
+    for (int round = 0; round < 200; ++round) {
+        std::string text = generator.nested(8, 5);
+        if (text[0] != '(') continue;
+        ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(text);
+        compact.assign(expressionTree, root.get());
+        double expected = 0;
+        try {
+            expected = static_cast<double>(expressionTree.evaluate(root.get(), bindings));
+        } catch (const std::runtime_error&) {
+            EXPECT_THROW(compact.evaluate(bindings), std::runtime_error) << text;
+            continue;
+        }
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(compact.evaluate(bindings))) << text;
+        } else {
+            EXPECT_DOUBLE_EQ(compact.evaluate(bindings), expected) << text;
+        }
+    }
+
+    compact.assign(expressionTree, expressionTree.buildTreeFromInfix(std::string("A + D / 2")).get());
+    try {
+        compact.evaluate(bindings);
+        FAIL() << "D has no value";
+    } catch (const std::runtime_error& e) {
+        EXPECT_EQ(std::string(e.what()), "Undefined variable: D");
+    }
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "CompiledExpression.h"
+#include "ExpressionTree.h"
+
+class CompiledExpressionTest : public ::testing::Test {
+protected:
+    ExpressionTree expressionTree;
+    VariableBindings bindings;
+
+    // Checks a compiled expression against the tree the runtime parser builds
+    template<typename Compiled>
+    void expectSameAsTree(Compiled& compiled, const std::string& text) {
+        ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(text);
+        EXPECT_EQ(compiled.inorder(), expressionTree.inorder(root.get())) << text;
+        compiled.bind(*expressionTree.symbols);
+        EXPECT_DOUBLE_EQ(compiled.evaluate(bindings), static_cast<double>(expressionTree.evaluate(root.get(), bindings)))
+            << text;
+    }
+
+    void SetUp() override {
+        bindings.set(expressionTree.symbols->intern("AX"), 2.5);
+        bindings.set(expressionTree.symbols->intern("BX"), -4);
+        bindings.set(expressionTree.symbols->intern("y1"), 3);
+    }
+};
+
+// Test that compiled expressions parse and evaluate like the runtime parser
+TEST_F(CompiledExpressionTest, MatchesRuntimeParser) {
+    auto area = ET_COMPILE("( AX * BX ) + 3");
+    static_assert(decltype(area)::variableCount() == 2, "AX and BX");
+    expectSameAsTree(area, "( AX * BX ) + 3");
+    EXPECT_DOUBLE_EQ(area.evaluate(bindings), -7);
+
+    auto power = ET_COMPILE("2 ^ 3 ^ 2");
+    expectSameAsTree(power, "2 ^ 3 ^ 2");
+    EXPECT_DOUBLE_EQ(power.evaluate(static_cast<const double*>(nullptr)), 512);
+
+    auto chain = ET_COMPILE("AX - BX - y1 * AX / (y1 - -0.5) % 2");
+    expectSameAsTree(chain, "AX - BX - y1 * AX / (y1 - -0.5) % 2");
+
+    auto compact = ET_COMPILE("((AX))*-2+y1^2^0.5");
+    expectSameAsTree(compact, "((AX))*-2+y1^2^0.5");
+
+    auto literals = ET_COMPILE("0.1 + 007 * 3.50 - .25 + 5.");
+    expectSameAsTree(literals, "0.1 + 007 * 3.50 - .25 + 5.");
+    EXPECT_DOUBLE_EQ(literals.evaluate(static_cast<const double*>(nullptr)), 0.1 + 7 * 3.5 - 0.25 + 5);
+}
+
+// Test evaluation by slot and runtime errors
+TEST_F(CompiledExpressionTest, SlotsAndErrors) {
+    auto expression = ET_COMPILE("y1 / (AX - y1) + AX");
+    EXPECT_EQ(expression.variable(0), "y1");
+    EXPECT_EQ(expression.variable(1), "AX");
+    const double values[] = {6, 4};
+    EXPECT_DOUBLE_EQ(expression.evaluate(values), 1);
+    const double zero[] = {6, 6};
+    EXPECT_THROW(expression.evaluate(zero), std::runtime_error);
+
+    // Names are resolved through the symbol table only after bind.
+    EXPECT_THROW(expression.evaluate(bindings), std::runtime_error);
+    expression.bind(*expressionTree.symbols);
+    EXPECT_DOUBLE_EQ(expression.evaluate(bindings), 3 / (2.5 - 3) + 2.5);
+
+    auto unbound = ET_COMPILE("AX + CX");
+    unbound.bind(*expressionTree.symbols);
+    try {
+        unbound.evaluate(bindings);
+        FAIL() << "CX has no value";
+    } catch (const std::runtime_error& e) {
+        EXPECT_EQ(std::string(e.what()), "Undefined variable: CX");
+    }
+}
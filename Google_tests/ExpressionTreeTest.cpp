@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <type_traits>
 #include <unordered_map>
 #include "ExpressionTree.h"
+#include "TestExpressions.h"
+#include "ThreadPool.h"
 
 class ExpressionTreeTest : public ::testing::Test {
 protected:
@@ -41,6 +46,352 @@ TEST_F(ExpressionTreeTest, TokenizationTest) {
     EXPECT_EQ(tokens3[6], ")");
 }
 
+// Test tokenization of compact input without spaces
+TEST_F(ExpressionTreeTest, CompactTokenizationTest) {
+    MyVector tokens = expressionTree.tokenize("A+B*(C-D)");
+    EXPECT_EQ(tokens.getSize(), 9);
+    EXPECT_EQ(tokens[0], "A");
+    EXPECT_EQ(tokens[3], "*");
+    EXPECT_EQ(tokens[4], "(");
+    EXPECT_EQ(tokens[6], "-");
+    EXPECT_EQ(tokens[8], ")");
+
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix("A+B*(C-D)");
+    EXPECT_EQ(expressionTree.postorder(root.get()), "A B C D - * +");
+
+    ExpressionTree::TreeHandle negativeRoot = expressionTree.buildTreeFromInfix("2*-3-1");
+    EXPECT_EQ(expressionTree.preorder(negativeRoot.get()), "- * 2 -3 1");
+}
+
+// Test typed tokenization and the typed build functions
+TEST_F(ExpressionTreeTest, TypedTokenTest) {
+    TokenList tokens;
+    expressionTree.tokenize("AX BX AX * +", tokens);
+    ASSERT_EQ(tokens.getSize(), 5);
+    EXPECT_EQ(tokens[0].kind, TokenKind::Variable);
+    EXPECT_EQ(tokens[0].symbol, tokens[2].symbol);
+    EXPECT_NE(tokens[0].symbol, tokens[1].symbol);
+    EXPECT_EQ(tokens[3].op, OpCode::Multiply);
+    EXPECT_EQ(tokens.text(tokens[1]), "BX");
+    EXPECT_EQ(expressionTree.determineExpressionType(tokens), 3);
+
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromPostfix(tokens);
+    EXPECT_EQ(expressionTree.inorder(root.get()), "( AX + ( BX * AX ) )");
+    std::unordered_map<std::string, double> variables = {{"AX", 2.0}, {"BX", 5.0}};
+    EXPECT_NEAR(expressionTree.evaluate(root.get(), variables), 12.0, 1e-9);
+
+    // Malformed tokens are reported instead of being skipped
+    EXPECT_THROW(expressionTree.buildTreeFromInfix("5 + 3.14.5"), std::runtime_error);
+    EXPECT_THROW(expressionTree.buildTreeFromPostfix(expressionTree.tokenize("1x 2 +")), std::runtime_error);
+}
+
+// Test that trees carry symbol ids and evaluate from id-indexed bindings
+TEST_F(ExpressionTreeTest, SymbolBindingsTest) {
+    SymbolTable shared;
+    ExpressionTree first(shared);
+    ExpressionTree second(shared);
+    TokenList tokens;
+    second.tokenize("CY", tokens);
+    first.tokenize("AX CY -", tokens);
+    EXPECT_EQ(tokens[0].symbol, shared.find("AX"));
+    EXPECT_EQ(tokens[1].symbol, 0u);
+
+    ExpressionTree::TreeHandle root = first.buildTreeFromPostfix(tokens);
+    VariableBindings bindings;
+    bindings.set(shared.find("AX"), 10.0);
+    bindings.set(shared.find("CY"), 4.0);
+    EXPECT_NEAR(first.evaluate(root.get(), bindings), 6.0, 1e-9);
+    EXPECT_NEAR(second.evaluate(root.get(), bindings), 6.0, 1e-9);
+}
+
+// Test that number nodes hold their parsed value
+TEST_F(ExpressionTreeTest, ParsedNumberTest) {
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix("-2.5 * 4");
+    ASSERT_NE(root.get(), nullptr);
+    EXPECT_DOUBLE_EQ(root->left->number, -2.5);
+    EXPECT_DOUBLE_EQ(root->right->number, 4.0);
+    EXPECT_EQ(expressionTree.spelling(root->left), "-2.5");
+
+    std::unordered_map<std::string, double> emptyVars;
+    EXPECT_NEAR(expressionTree.evaluate(root.get(), emptyVars), -10.0, 1e-12);
+
+    TokenList tokens;
+    expressionTree.tokenize("0.125", tokens);
+    ExpressionTree::TreeNode leaf(tokens[0], expressionTree.keepSpellings(tokens, 0, 1));
+    EXPECT_DOUBLE_EQ(leaf.number, 0.125);
+    EXPECT_EQ(expressionTree.spelling(&leaf), "0.125");
+}
+
+// Test the single-pass infix parser on pre-tokenized input
+TEST_F(ExpressionTreeTest, FusedInfixTest) {
+    const char* expressions[] = {"A + B * C", "(A + B) * C", "2 ^ 3 ^ 2", "A - B - C", "A / (B - C) % D ^ E",
+                                 "((X))*-2", "1-2*3+4/5^6^7%8"};
+    for (const char* text : expressions) {
+        TokenList tokens;
+        expressionTree.tokenize(text, tokens);
+        ExpressionTree::TreeHandle fused = expressionTree.buildTreeFromInfix(tokens);
+        ExpressionTree::TreeHandle classic = expressionTree.buildTreeFromInfix(std::string(text));
+        EXPECT_EQ(expressionTree.postorder(fused.get()), expressionTree.postorder(classic.get())) << text;
+    }
+    ExpressionTree::TreeHandle power = expressionTree.buildTreeFromInfix(std::string("2 ^ 3 ^ 2"));
+    EXPECT_EQ(expressionTree.postorder(power.get()), "2 3 2 ^ ^");
+
+    // Errors carry the messages of the separate validators.
+    auto errorOf = [&](const std::string& text) {
+        TokenList tokens;
+        expressionTree.tokenize(text, tokens);
+        try {
+            expressionTree.buildTreeFromInfix(tokens);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    EXPECT_EQ(errorOf("+ A B"), "Incorrect expression type. Expected Infix, but got Prefix expression.");
+    EXPECT_EQ(errorOf("A B +"), "Incorrect expression type. Expected Infix, but got Postfix expression.");
+    EXPECT_EQ(errorOf("( 5 )"), "Unable to determine expression type");
+    EXPECT_EQ(errorOf("A * ( B + C"), "Unbalanced parentheses");
+    EXPECT_EQ(errorOf("A + B ) * C"), "Unbalanced parentheses: Too many closing parentheses");
+    EXPECT_EQ(errorOf("A + * B"), "Invalid syntax: Consecutive operators");
+    EXPECT_EQ(errorOf("A ( B + C )"), "Invalid syntax: Missing operator before opening parenthesis");
+    EXPECT_EQ(errorOf("( A + ) * B"), "Incomplete expression: Not enough operands for operators");
+    EXPECT_EQ(errorOf("A + 3.1.4"), "Invalid token in infix expression: 3.1.4");
+    EXPECT_EQ(errorOf(""), "Empty expression. Enter an expression made of numbers, variables, operators, and parentheses");
+
+    // Deep nesting does not recurse.
+    std::string deep = std::string(200000, '(') + "A" + std::string(200000, ')') + " + 1";
+    TokenList tokens;
+    expressionTree.tokenize(deep, tokens);
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(tokens);
+    EXPECT_EQ(expressionTree.postorder(root.get()), "A 1 +");
+}
+
+// Test that the prefix and postfix builders validate while they build
+TEST_F(ExpressionTreeTest, FusedPrefixPostfixTest) {
+    auto errorOf = [&](const std::string& text, bool prefix) {
+        TokenList tokens;
+        expressionTree.tokenize(text, tokens);
+        try {
+            if (prefix) expressionTree.buildTreeFromPrefix(tokens); else expressionTree.buildTreeFromPostfix(tokens);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    EXPECT_EQ(errorOf("- * A B C", true), "");
+    EXPECT_EQ(errorOf("A B * C -", false), "");
+    EXPECT_EQ(errorOf("+ A", true), "Prefix validation error: Insufficient operands for operator '+'");
+    EXPECT_EQ(errorOf("A +", false), "Postfix validation error: Insufficient operands for operator '+'");
+    EXPECT_EQ(errorOf("+ A B C", true), "Invalid prefix expression: Incorrect number of operands");
+    EXPECT_EQ(errorOf("A B C +", false), "Invalid postfix expression: Incorrect number of operands");
+    EXPECT_EQ(errorOf("+ ( A B", true), "Invalid token in prefix expression: (");
+    EXPECT_EQ(errorOf("A B ) +", false), "Invalid token in postfix expression: )");
+}
+
+// Test that parse() reports every problem with its position instead of throwing
+TEST_F(ExpressionTreeTest, ParseResultTest) {
+    ExpressionTree::ParseResult result = expressionTree.parse("(A + B) * C", 1);
+    ASSERT_TRUE(result.ok());
+    EXPECT_TRUE(result.diagnostics.empty());
+    EXPECT_EQ(expressionTree.postorder(result.root.get()), "A B + C *");
+
+    // Several infix mistakes are found in one call, in input order.
+    result = expressionTree.parse("A + * B ) + (C D", 1);
+    EXPECT_FALSE(result.ok());
+    ASSERT_EQ(result.diagnostics.size(), 4u);
+    EXPECT_EQ(result.diagnostics[0].code, DiagnosticCode::ConsecutiveOperators);
+    EXPECT_EQ(result.diagnostics[0].tokenIndex, 2);
+    EXPECT_EQ(result.diagnostics[0].offset, 4u);
+    EXPECT_EQ(result.diagnostics[1].code, DiagnosticCode::TooManyClosingParentheses);
+    EXPECT_EQ(result.diagnostics[1].offset, 8u);
+    EXPECT_EQ(result.diagnostics[2].code, DiagnosticCode::MissingOperatorBetweenOperands);
+    EXPECT_EQ(result.diagnostics[2].offset, 15u);
+    EXPECT_EQ(result.diagnostics[3].code, DiagnosticCode::UnbalancedParentheses);
+    EXPECT_EQ(result.diagnostics[3].offset, 12u);
+
+    // Prefix and postfix input keeps being checked after the first error.
+    result = expressionTree.parse("A + B ) C -", 3);
+    EXPECT_FALSE(result.ok());
+    ASSERT_EQ(result.diagnostics.size(), 3u);
+    EXPECT_EQ(result.diagnostics[0].code, DiagnosticCode::InsufficientOperands);
+    EXPECT_EQ(result.diagnostics[0].tokenIndex, 1);
+    EXPECT_EQ(result.diagnostics[1].code, DiagnosticCode::InvalidToken);
+    EXPECT_EQ(result.diagnostics[1].message, "Invalid token in postfix expression: )");
+    EXPECT_EQ(result.diagnostics[2].code, DiagnosticCode::IncorrectOperandCount);
+    EXPECT_EQ(result.diagnostics[2].tokenIndex, -1);
+
+    result = expressionTree.parse("- * A B C", 2);
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(expressionTree.postorder(result.root.get()), "A B * C -");
+
+    // Type problems come first, followed by the problems in the expected notation.
+    result = expressionTree.parse("", 1);
+    ASSERT_EQ(result.diagnostics.size(), 1u);
+    EXPECT_EQ(result.diagnostics[0].code, DiagnosticCode::EmptyExpression);
+    result = expressionTree.parse("A B +", 2);
+    ASSERT_EQ(result.diagnostics.size(), 3u);
+    EXPECT_EQ(result.diagnostics[0].message, "Incorrect expression type. Expected Prefix, but got Postfix expression.");
+    EXPECT_EQ(result.diagnostics[1].code, DiagnosticCode::InsufficientOperands);
+    EXPECT_EQ(result.diagnostics[1].tokenIndex, 2);
+    EXPECT_EQ(result.diagnostics[2].code, DiagnosticCode::IncorrectOperandCount);
+    result = expressionTree.parse("A B ( C", 1);
+    ASSERT_EQ(result.diagnostics.size(), 4u);
+    EXPECT_EQ(result.diagnostics[0].code, DiagnosticCode::UnknownExpressionType);
+    EXPECT_EQ(result.diagnostics[1].code, DiagnosticCode::MissingOperatorBetweenOperands);
+    EXPECT_EQ(result.diagnostics[2].code, DiagnosticCode::MissingOperatorBeforeParenthesis);
+    EXPECT_EQ(result.diagnostics[3].code, DiagnosticCode::UnbalancedParentheses);
+    result = expressionTree.parse("A + B", 7);
+    EXPECT_FALSE(result.ok());
+    EXPECT_EQ(result.diagnostics[0].code, DiagnosticCode::WrongExpressionType);
+}
+
+// Test that the parallel postfix builder gives the serial tree
+TEST_F(ExpressionTreeTest, ParallelPostfixTest) {
+    std::mt19937 random(11);
+    const char* operators[] = {"+", "-", "*", "/", "%", "^"};
+    std::string postfix;
+    int depth = 0;
+    for (int i = 0; i < 300000; ++i) {
+        if (depth < 2 || random() % 2) {
+            postfix += (random() % 2 ? "x" + std::to_string(random() % 50) : std::to_string(random() % 100)) + " ";
+            ++depth;
+        } else {
+            postfix += std::string(operators[random() % 6]) + " ";
+            --depth;
+        }
+    }
+    for (; depth > 1; --depth) postfix += "+ ";
+
+    TokenList tokens;
+    expressionTree.tokenize(postfix, tokens);
+    ThreadPool pool(4);
+    ExpressionTree::TreeHandle serial = expressionTree.buildTreeFromPostfix(tokens);
+    ExpressionTree::TreeHandle parallel = expressionTree.buildTreeFromPostfixParallel(tokens, &pool);
+    EXPECT_EQ(expressionTree.postorder(parallel.get()), expressionTree.postorder(serial.get()));
+    EXPECT_EQ(expressionTree.inorder(parallel.get()), expressionTree.inorder(serial.get()));
+
+    // Invalid input reports the serial builder's error.
+    TokenList bad;
+    expressionTree.tokenize(postfix + "+", bad);
+    try {
+        expressionTree.buildTreeFromPostfixParallel(bad, &pool);
+        FAIL() << "expected an error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_STREQ(e.what(), "Postfix validation error: Insufficient operands for operator '+'");
+    }
+}
+
+// Test that the parallel infix parser gives the serial tree
+TEST_F(ExpressionTreeTest, ParallelInfixTest) {
+    // Random expression with nested groups of varying size
+    std::vector<std::string> operands;
+    for (int i = 0; i < 20; ++i) operands.push_back("x" + std::to_string(i));
+    for (int i = 0; i < 100; i += 5) operands.push_back(std::to_string(i));
+    ExpressionGenerator generator(5, {"+", "-", "*", "/", "%", "^"}, operands);
+    std::string expressions[3];
+    while (expressions[0].size() < 300000) {
+        expressions[0] += (expressions[0].empty() ? "" : " - ") + generator.chain(1 << 10);
+    }
+    expressions[1] = "((" + expressions[0] + ")) ^ 2 ^ (" + expressions[0] + ")";
+    for (int i = 0; i < 10000; ++i) expressions[2] += i ? " + (x1 * 2 ^ y)" : "(x1 * 2 ^ y)";
+
+    ThreadPool pool(4);
+    for (const std::string& expression : expressions) {
+        TokenList tokens;
+        expressionTree.tokenize(expression, tokens);
+        ASSERT_GE(tokens.getSize(), 1 << 16);
+        ExpressionTree::TreeHandle serial = expressionTree.buildTreeFromInfix(tokens);
+        ExpressionTree::TreeHandle parallel = expressionTree.buildTreeFromInfixParallel(tokens, &pool);
+        EXPECT_EQ(expressionTree.postorder(parallel.get()), expressionTree.postorder(serial.get()));
+    }
+
+    // Invalid input reports the serial parser's error.
+    TokenList bad;
+    expressionTree.tokenize(expressions[0] + " + (1", bad);
+    try {
+        expressionTree.buildTreeFromInfixParallel(bad, &pool);
+        FAIL() << "expected an error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_STREQ(e.what(), "Unbalanced parentheses");
+    }
+}
+
+// Test that walks over a million-level tree do not overflow the call stack
+TEST_F(ExpressionTreeTest, DeepTreeTest) {
+    const int terms = 1000000;
+    std::string expression = "A";
+    expression.reserve(terms * 4);
+    for (int i = 1; i < terms; ++i) expression += " + 1";
+    TokenList tokens;
+    expressionTree.tokenize(expression, tokens);
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(tokens);
+
+    std::unordered_map<std::string, double> variables = {{"A", 0.5}};
+    EXPECT_DOUBLE_EQ(static_cast<double>(expressionTree.evaluate(root.get(), variables)), terms - 0.5);
+    std::string postfix = expressionTree.postorder(root.get());
+    EXPECT_EQ(postfix.size(), static_cast<size_t>(1 + 4 * (terms - 1)));
+    EXPECT_EQ(postfix.substr(0, 9), "A 1 + 1 +");
+    EXPECT_EQ(expressionTree.preorder(root.get()).substr(0, 6), "+ + + ");
+    EXPECT_EQ(expressionTree.inorder(root.get()).size(), expression.size() + 4 * static_cast<size_t>(terms - 1));
+}
+
+// Test that the parallel tokenizer gives exactly the serial tokens and ids
+TEST_F(ExpressionTreeTest, ParallelTokenizeTest) {
+    std::string expression = "(A1 -2";
+    const char* pieces[] = {" * B", "-3.5", "/(C+", "D2)", " - -7", "^x", "1x", " % 4 ", "\t+ y", "-z"};
+    for (int i = 0; expression.size() < (3u << 20); ++i) {
+        expression += pieces[i % 10];
+        if (i % 1000 == 0) expression += " v" + std::to_string(i);
+    }
+    expression += ")";
+
+    ExpressionTree serialTree;
+    TokenList serial;
+    serialTree.tokenize(expression, serial);
+    TokenList parallel;
+    ThreadPool pool(4);
+    expressionTree.tokenizeParallel(expression, parallel, &pool);
+
+    ASSERT_EQ(parallel.getSize(), serial.getSize());
+    for (int i = 0; i < serial.getSize(); ++i) {
+        const Token& a = serial[i];
+        const Token& b = parallel[i];
+        ASSERT_EQ(a.kind, b.kind) << i;
+        ASSERT_EQ(a.offset, b.offset) << i;
+        ASSERT_EQ(a.length, b.length) << i;
+        ASSERT_EQ(a.op, b.op) << i;
+        if (a.kind == TokenKind::Number) {
+            ASSERT_EQ(a.number, b.number) << i;
+        }
+        if (a.kind == TokenKind::Variable) {
+            ASSERT_EQ(a.symbol, b.symbol) << i;
+        }
+    }
+    EXPECT_EQ(expressionTree.symbols->size(), serialTree.symbols->size());
+}
+
+// Test bulk loading of variable values from text
+TEST_F(ExpressionTreeTest, LoadBindingsTest) {
+    std::string text = "# values\nA 2\n\n  B = -1.5e1\r\n";
+    for (int i = 0; i < 100000; ++i) text += "v" + std::to_string(i) + " " + std::to_string(i) + ".5\n";
+    text += "C 4";  // No trailing newline
+    std::istringstream input(text);
+    VariableBindings bindings;
+    EXPECT_EQ(expressionTree.loadVariableBindings(input, bindings), 100003u);
+
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix("(A + B) * C - v99999");
+    ASSERT_NE(root.get(), nullptr);
+    EXPECT_NEAR(expressionTree.evaluate(root.get(), bindings), -52.0 - 99999.5, 1e-9);
+
+    std::istringstream bad("A 1\nB two\n");
+    EXPECT_THROW(expressionTree.loadVariableBindings(bad, bindings), std::runtime_error);
+    // Names the lexer cannot produce are rejected, not silently stored.
+    std::istringstream underscore("my_var = 3\n");
+    EXPECT_THROW(expressionTree.loadVariableBindings(underscore, bindings), std::runtime_error);
+    std::istringstream leading("_A 3\n");
+    EXPECT_THROW(expressionTree.loadVariableBindings(leading, bindings), std::runtime_error);
+}
+
 // Test Expression Type Detection
 TEST_F(ExpressionTreeTest, ExpressionTypeDetectionTest) {
     // Infix expressions
@@ -60,56 +411,52 @@ TEST_F(ExpressionTreeTest, ExpressionTypeDetectionTest) {
 TEST_F(ExpressionTreeTest, TreeBuildingTest) {
     // Infix Expression with Variables
     std::string infixExpr = "( AX * ( BX * ( ( ( CY + AY ) + BY ) * CX ) ) )";
-    ExpressionTree::TreeNode* infixRoot = expressionTree.buildTreeFromInfix(infixExpr);
-    EXPECT_NE(infixRoot, nullptr);
+    ExpressionTree::TreeHandle infixRoot = expressionTree.buildTreeFromInfix(infixExpr);
+    EXPECT_NE(infixRoot.get(), nullptr);
 
-    std::string infixTraversal = expressionTree.inorder(infixRoot);
+    std::string infixTraversal = expressionTree.inorder(infixRoot.get());
     EXPECT_FALSE(infixTraversal.empty());
 
     // Prefix Expression with Variables
     MyVector prefixTokens = expressionTree.tokenize("* AX * BX * + + CY AY BY CX");
-    ExpressionTree::TreeNode* prefixRoot = expressionTree.buildTreeFromPrefix(prefixTokens);
-    EXPECT_NE(prefixRoot, nullptr);
+    ExpressionTree::TreeHandle prefixRoot = expressionTree.buildTreeFromPrefix(prefixTokens);
+    EXPECT_NE(prefixRoot.get(), nullptr);
 
-    std::string prefixTraversal = expressionTree.preorder(prefixRoot);
+    std::string prefixTraversal = expressionTree.preorder(prefixRoot.get());
     EXPECT_FALSE(prefixTraversal.empty());
 
     // Postfix Expression with Variables
     MyVector postfixTokens = expressionTree.tokenize("AX BX CY AY + BY + CX * * *");
-    ExpressionTree::TreeNode* postfixRoot = expressionTree.buildTreeFromPostfix(postfixTokens);
-    EXPECT_NE(postfixRoot, nullptr);
+    ExpressionTree::TreeHandle postfixRoot = expressionTree.buildTreeFromPostfix(postfixTokens);
+    EXPECT_NE(postfixRoot.get(), nullptr);
 
-    std::string postfixTraversal = expressionTree.postorder(postfixRoot);
+    std::string postfixTraversal = expressionTree.postorder(postfixRoot.get());
     EXPECT_FALSE(postfixTraversal.empty());
 
     // Cleanup
-    expressionTree.deleteTree(infixRoot);
-    expressionTree.deleteTree(prefixRoot);
-    expressionTree.deleteTree(postfixRoot);
 }
 
 // Test Traversal Methods
 TEST_F(ExpressionTreeTest, TraversalMethodsTest) {
     std::string infixExpr = "( 5 + 3 ) * 2";
-    ExpressionTree::TreeNode* root = expressionTree.buildTreeFromInfix(infixExpr);
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(infixExpr);
 
-    std::string inorderResult = expressionTree.inorder(root);
+    std::string inorderResult = expressionTree.inorder(root.get());
     EXPECT_EQ(inorderResult, "( ( 5 + 3 ) * 2 )");
 
-    std::string preorderResult = expressionTree.preorder(root);
+    std::string preorderResult = expressionTree.preorder(root.get());
     EXPECT_EQ(preorderResult, "* + 5 3 2");
 
-    std::string postorderResult = expressionTree.postorder(root);
+    std::string postorderResult = expressionTree.postorder(root.get());
     EXPECT_EQ(postorderResult, "5 3 + 2 *");
 
-    expressionTree.deleteTree(root);
 }
 
 // Test Evaluation with multi-Variables
 TEST_F(ExpressionTreeTest, EvaluationTest) {
     // Test with multiple variables
     std::string expr = "( AX * ( BX * ( ( ( CY + AY ) + BY ) * CX ) ) )";
-    ExpressionTree::TreeNode* root = expressionTree.buildTreeFromInfix(expr);
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(expr);
 
     std::unordered_map<std::string, double> variables = {
         {"AX", 2.0}, {"BX", 3.0},
@@ -118,23 +465,21 @@ TEST_F(ExpressionTreeTest, EvaluationTest) {
     };
 
     EXPECT_NO_THROW({
-        long double result = expressionTree.evaluate(root, variables);
+        long double result = expressionTree.evaluate(root.get(), variables);
         EXPECT_NEAR(result, 120.0, 1e-9);
     });
 
-    expressionTree.deleteTree(root);
 }
 
 // Test Arithmetic Expression with Various Operators
 TEST_F(ExpressionTreeTest, ComplexArithmeticTest) {
     std::string expr = "123 - 4 * 5 + 33 / 11 - 2 ^ 3 + 45 * 2";
-    ExpressionTree::TreeNode* root = expressionTree.buildTreeFromInfix(expr);
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(expr);
 
     std::unordered_map<std::string, double> emptyVars;
-    long double result = expressionTree.evaluate(root, emptyVars);
+    long double result = expressionTree.evaluate(root.get(), emptyVars);
     EXPECT_NEAR(result, 188.0, 1e-9);
 
-    expressionTree.deleteTree(root);
 }
 
 // Error Handling Tests
@@ -146,14 +491,13 @@ TEST_F(ExpressionTreeTest, ErrorHandlingTest) {
 
     // Test division by zero
     std::string divByZeroExpr = "10 / 0";
-    ExpressionTree::TreeNode* root = expressionTree.buildTreeFromInfix(divByZeroExpr);
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(divByZeroExpr);
     std::unordered_map<std::string, double> emptyVars;
 
     EXPECT_THROW({
-        expressionTree.evaluate(root, emptyVars);
+        expressionTree.evaluate(root.get(), emptyVars);
     }, std::runtime_error);
 
-    if (root) expressionTree.deleteTree(root);
 
     // Test unbalanced expression
     EXPECT_THROW({
@@ -179,7 +523,7 @@ TEST_F(ExpressionTreeTest, ValidationTests) {
 // Additional Complex Expressions Test
 TEST_F(ExpressionTreeTest, ComplexExpressionsTest) {
     std::string complexInfix = "( ( H * ( ( ( ( A + ( ( B + C ) * D ) ) * F ) * G ) * E ) ) + J )";
-    ExpressionTree::TreeNode* root = expressionTree.buildTreeFromInfix(complexInfix);
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(complexInfix);
 
     std::unordered_map<std::string, double> variables = {
         {"H", 2.0}, {"A", 3.0}, {"B", 4.0},
@@ -188,10 +532,213 @@ TEST_F(ExpressionTreeTest, ComplexExpressionsTest) {
     };
 
     EXPECT_NO_THROW({
-        long double result = expressionTree.evaluate(root, variables);
+        long double result = expressionTree.evaluate(root.get(), variables);
         EXPECT_TRUE(result != 0);  // Just ensuring a non-zero result
     });
 
-    expressionTree.deleteTree(root);
 }
 
+
+// Test that a depth-first relayout keeps the tree and puts it in one pre-order run
+TEST_F(ExpressionTreeTest, RelayoutDepthFirst) {
+    std::string infix = "( A + 2 ) * ( B - C / 4 ) ^ 2";
+    ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(infix);
+    const std::string inorder = expressionTree.inorder(root.get());
+    const std::string postfix = expressionTree.postorder(root.get());
+    const size_t nodeCount = expressionTree.arena.size();
+    std::unordered_map<std::string, double> variables = {{"A", 1.5}, {"B", 3.0}, {"C", 2.0}};
+    const long double expected = expressionTree.evaluate(root.get(), variables);
+
+    root = expressionTree.relayout(std::move(root));
+    EXPECT_EQ(expressionTree.arena.size(), nodeCount);
+    EXPECT_EQ(expressionTree.inorder(root.get()), inorder);
+    EXPECT_EQ(expressionTree.postorder(root.get()), postfix);
+    EXPECT_DOUBLE_EQ(static_cast<double>(expressionTree.evaluate(root.get(), variables)), static_cast<double>(expected));
+
+    // Pre-order positions: each node is followed by its left subtree.
+    std::vector<ExpressionTree::TreeNode*> stack = {root.get()};
+    for (size_t i = 0; !stack.empty(); ++i) {
+        ExpressionTree::TreeNode* node = stack.back();
+        stack.pop_back();
+        EXPECT_EQ(node, root.get() + i);
+        if (node->left) {
+            EXPECT_EQ(node->left, node + 1);
+        }
+        if (node->right) stack.push_back(node->right);
+        if (node->left) stack.push_back(node->left);
+    }
+    root.reset();
+    EXPECT_EQ(expressionTree.arena.size(), 0u);
+}
+
+// Test that relaying out trees over and over gives each run's block back
+TEST_F(ExpressionTreeTest, RelayoutReclaimsRuns) {
+    ExpressionGenerator generator(8, {"+", "-", "*", "/"}, {"A", "B", "1", "2"});
+    size_t blocks = 0;
+    for (int round = 0; round < 500; ++round) {
+        std::string text = generator.nested(8, 5);
+        if (text[0] != '(') text = "( " + text + " + 1 )";
+        ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(text);
+        root = expressionTree.relayout(std::move(root), round % 2 ? TreeLayout::VanEmdeBoas : TreeLayout::DepthFirst);
+        root = expressionTree.relayout(std::move(root));
+        if (round == 0) blocks = expressionTree.arena.blockCount();
+        ASSERT_LE(expressionTree.arena.blockCount(), blocks + 1) << round;
+    }
+    EXPECT_EQ(expressionTree.arena.size(), 0u);
+}
+
+// Test the van Emde Boas order of a complete tree and that random trees survive it
+TEST_F(ExpressionTreeTest, RelayoutVanEmdeBoas) {
+    // Four levels: the top two levels first, then each two-level subtree below them.
+    ExpressionTree::TreeHandle root =
+        expressionTree.buildTreeFromPrefix(expressionTree.tokenize("+ * - A B - C D * - E F - G H"));
+    root = expressionTree.relayout(std::move(root), TreeLayout::VanEmdeBoas);
+    std::string order;
+    for (int i = 0; i < 15; ++i) order += expressionTree.spelling(root.get() + i);
+    EXPECT_EQ(order, "+**-AB-CD-EF-GH");
+    EXPECT_EQ(expressionTree.preorder(root.get()), "+ * - A B - C D * - E F - G H");
+    root.reset();
+
+    // A copy leaves the original in place and can live in another arena.
+    ExpressionGenerator generator(4, {"+", "-", "*", "/"}, {"A", "B", "1", "2"});
+    NodeArena<ExpressionTree::TreeNode> copies;
+    for (int round = 0; round < 50; ++round) {
+        std::string text = generator.nested(9, 4);
+        if (text[0] != '(') continue;
+        ExpressionTree::TreeHandle original = expressionTree.buildTreeFromInfix(text);
+        ExpressionTree::TreeNode* copy = ExpressionTree::copyWithLayout(copies, original.get(), TreeLayout::VanEmdeBoas);
+        EXPECT_EQ(expressionTree.inorder(copy), expressionTree.inorder(original.get())) << text;
+        EXPECT_EQ(expressionTree.inorder(original.get()), text) << text;
+    }
+    EXPECT_EQ(expressionTree.arena.size(), 0u);
+}
+
+// Test that handles free their trees when replaced, moved over or unwound past
+TEST_F(ExpressionTreeTest, TreeHandleOwnership) {
+    ExpressionTree::TreeHandle first = expressionTree.buildTreeFromInfix(std::string("A + B * C"));
+    EXPECT_EQ(expressionTree.arena.size(), 5u);
+    ExpressionTree::TreeHandle second = std::move(first);
+    EXPECT_FALSE(first);
+    EXPECT_EQ(expressionTree.postorder(second.get()), "A B C * +");
+
+    // The tree holds its own expression; replacing it frees the old one.
+    expressionTree.root = std::move(second);
+    expressionTree.root = expressionTree.parse("A - 1", 1).root;
+    EXPECT_EQ(expressionTree.arena.size(), 3u);
+    EXPECT_EQ(expressionTree.spelling(expressionTree.root.get()), "-");
+
+    // A failed evaluation no longer strands the tree being evaluated.
+    std::unordered_map<std::string, double> noValues;
+    try {
+        ExpressionTree::TreeHandle tree = expressionTree.buildTreeFromPostfix(expressionTree.tokenize("A B /"));
+        expressionTree.evaluate(tree.get(), noValues);
+        FAIL() << "Undefined variables should throw";
+    } catch (const std::runtime_error&) {
+    }
+    EXPECT_EQ(expressionTree.arena.size(), 3u);
+
+    ExpressionTree::TreeNode* released = expressionTree.root.release();
+    EXPECT_FALSE(expressionTree.root);
+    expressionTree.deleteTree(released);
+    EXPECT_EQ(expressionTree.arena.size(), 0u);
+}
+
+// Test that reset frees every tree at once and leaves outstanding handles harmless
+TEST_F(ExpressionTreeTest, ResetDropsEveryTree) {
+    static_assert(std::is_trivially_destructible<ExpressionTree::TreeNode>::value,
+                  "nodes are freed by dropping whole blocks");
+    ExpressionTree::TreeHandle held = expressionTree.parse("( A + 2.50 ) * 7", 1).root;
+    expressionTree.root = expressionTree.parse("A - B", 1).root;
+    std::vector<ExpressionTree::TreeHandle> built;
+    for (int i = 0; i < 1000; ++i) built.push_back(expressionTree.buildTreeFromInfix(std::string("A * B + C")));
+    EXPECT_EQ(expressionTree.arena.size(), 5008u);
+    EXPECT_EQ(expressionTree.inorder(held.get()), "( ( A + 2.50 ) * 7 )");
+
+    expressionTree.reset();
+    EXPECT_FALSE(expressionTree.root);
+    EXPECT_EQ(expressionTree.arena.size(), 0u);
+    EXPECT_EQ(expressionTree.arena.blockCount(), 0u);
+    held.reset();  // Its nodes are gone already: frees nothing
+    built.clear();
+    EXPECT_EQ(expressionTree.arena.size(), 0u);
+
+    ExpressionTree::TreeHandle fresh = expressionTree.parse("A - 1", 1).root;
+    EXPECT_EQ(expressionTree.postorder(fresh.get()), "A 1 -");
+    EXPECT_EQ(expressionTree.arena.size(), 3u);
+}
+
+// Test that number spellings are kept in text that lives and dies with the arena
+TEST_F(ExpressionTreeTest, SpellingsFollowTheArena) {
+    expressionTree.root = expressionTree.parse("007 * 2.50", 1).root;
+    ExpressionTree::TreeHandle other = expressionTree.relayout(expressionTree.buildTreeFromPostfix(expressionTree.tokenize("-1 .5 +")));
+    const size_t kept = expressionTree.spellingText.size();
+    for (int i = 0; i < 100000; ++i) {
+        ExpressionTree::ParseResult sum = expressionTree.parse("A + " + std::to_string(i), 1);
+        ASSERT_TRUE(sum.ok());
+        if (i % 9999 == 0) EXPECT_EQ(expressionTree.spelling(sum.root->right), std::to_string(i));
+    }
+    EXPECT_EQ(expressionTree.spellingText.size(), kept);  // Dropped trees give their text back
+    for (int i = 0; i < 1000; ++i) EXPECT_FALSE(expressionTree.parse("1 + * " + std::to_string(i), 1).ok());
+    EXPECT_EQ(expressionTree.spellingText.size(), kept);  // So do failed parses
+    EXPECT_EQ(expressionTree.inorder(expressionTree.root.get()), "( 007 * 2.50 )");
+    EXPECT_EQ(expressionTree.inorder(other.get()), "( -1 + .5 )");
+
+    // Text under a tree that is still alive stays until that tree goes too.
+    ExpressionTree::TreeHandle later = expressionTree.parse("3.75 - 1", 1).root;
+    expressionTree.root.reset();
+    EXPECT_EQ(expressionTree.inorder(other.get()), "( -1 + .5 )");
+    EXPECT_EQ(expressionTree.inorder(later.get()), "( 3.75 - 1 )");
+    later.reset();
+    other.reset();
+    EXPECT_TRUE(expressionTree.spellingText.empty());
+
+    expressionTree.root = expressionTree.parse("1 + 2", 1).root;
+    EXPECT_FALSE(expressionTree.spellingText.empty());
+    expressionTree.reset();
+    EXPECT_TRUE(expressionTree.spellingText.empty());
+}
+
+// Test that failed builds of every kind leave nothing behind, so memory stays flat:
+// no nodes, no blocks, no interned names and no spelling text, even when every round
+// brings new names and literals and another tree is alive
+TEST_F(ExpressionTreeTest, FailedParsesKeepMemoryFlat) {
+    const char* invalidInfix[] = {"A + * B", "( A + B", "A + B )", "A B + C", "+ A B", "A +"};
+    const char* invalidPolish[] = {"+ A", "A B + +", "+ A B C", "A ( B +", "A B C +"};
+    auto failAll = [&](int round) {
+        // Distinct names and literals in every round: "v7", "7.5", ...
+        auto fresh = [&](const char* text) {
+            std::string result;
+            for (const char* c = text; *c; ++c) {
+                if (*c == 'A' || *c == 'B' || *c == 'C') result += std::string("v") + *c + std::to_string(round);
+                else result += *c;
+            }
+            return result + " ^ " + std::to_string(round) + ".5";
+        };
+        for (const char* text : invalidInfix) {
+            EXPECT_FALSE(expressionTree.parse(fresh(text), 1).ok());
+            EXPECT_THROW(expressionTree.buildTreeFromInfix(fresh(text)), std::runtime_error);
+        }
+        EXPECT_FALSE(expressionTree.parse("v" + std::to_string(round) + " + * 1", 1).ok());
+        for (const char* text : invalidPolish) {
+            EXPECT_FALSE(expressionTree.parse(fresh(text), 2).ok());
+            EXPECT_FALSE(expressionTree.parse(fresh(text), 3).ok());
+            EXPECT_THROW(expressionTree.buildTreeFromPrefix(expressionTree.tokenize(fresh(text))), std::runtime_error);
+            EXPECT_THROW(expressionTree.buildTreeFromPostfix(expressionTree.tokenize(fresh(text))), std::runtime_error);
+        }
+        // Successful parses whose results are dropped are freed too.
+        EXPECT_TRUE(expressionTree.parse("( A + B ) * " + std::to_string(round), 1).ok());
+    };
+    expressionTree.root = expressionTree.parse("( A + B ) * 2.5", 1).root;
+    failAll(0);
+    const size_t blocks = expressionTree.arena.blockCount();
+    const uint32_t names = expressionTree.symbols->size();
+    const size_t text = expressionTree.spellingText.size();
+    for (int round = 1; round <= 5000; ++round) {
+        failAll(round);
+        ASSERT_EQ(expressionTree.spellingText.size(), text);
+    }
+    EXPECT_EQ(expressionTree.arena.size(), 5u);
+    EXPECT_EQ(expressionTree.arena.blockCount(), blocks);
+    EXPECT_EQ(expressionTree.symbols->size(), names);
+    EXPECT_EQ(expressionTree.inorder(expressionTree.root.get()), "( ( A + B ) * 2.5 )");
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FlatTree.h"
+#include "ExpressionTree.h"
+#include "TestExpressions.h"
+
+class FlatTreeTest : public ::testing::Test {
+protected:
+    ExpressionTree expressionTree;
+    VariableBindings bindings;
+
+    void SetUp() override { bindTestVariables(expressionTree, bindings); }
+
+    TokenList tokenize(const std::string& text) {
+        TokenList tokens;
+        expressionTree.tokenize(text, tokens);
+        return tokens;
+    }
+};
+
+// Test that all three builders give the pointer tree's traversals and value
+TEST_F(FlatTreeTest, MatchesPointerTree) {
+    ExpressionGenerator generator(21, {"+", "-", "*", "^"},
+                                  {"A", "B", "C", "2", "3.50", "100000000000000000000000", "0.0000001"});
+    FlatTree flat;
+    for (int round = 0; round < 100; ++round) {
+        std::string text = generator.nested(6, 5);
+        if (text[0] != '(') continue;
+        ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(text);
+        const std::string prefix = expressionTree.preorder(root.get());
+        const std::string postfix = expressionTree.postorder(root.get());
+        const double expected = static_cast<double>(expressionTree.evaluate(root.get(), bindings));
+
+        flat.buildFromInfix(expressionTree, tokenize(text));
+        EXPECT_EQ(flat.inorder(), expressionTree.inorder(root.get())) << text;
+        EXPECT_EQ(flat.preorder(), prefix) << text;
+        EXPECT_EQ(flat.postorder(), postfix) << text;
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(flat.evaluate(bindings))) << text;
+        } else {
+            EXPECT_DOUBLE_EQ(flat.evaluate(bindings), expected) << text;
+        }
+
+        flat.buildFromPrefix(expressionTree, tokenize(prefix));
+        EXPECT_EQ(flat.postorder(), postfix) << prefix;
+        flat.buildFromPostfix(expressionTree, tokenize(postfix));
+        EXPECT_EQ(flat.preorder(), prefix) << postfix;
+    }
+}
+
+// Test that invalid input is rejected with the tree's errors
+TEST_F(FlatTreeTest, RejectsInvalidInput) {
+    FlatTree flat;
+    EXPECT_THROW(flat.buildFromInfix(expressionTree, tokenize("A + * B")), std::runtime_error);
+    EXPECT_THROW(flat.buildFromPrefix(expressionTree, tokenize("+ A")), std::runtime_error);
+    EXPECT_THROW(flat.buildFromPostfix(expressionTree, tokenize("A B + +")), std::runtime_error);
+    flat.buildFromPostfix(expressionTree, tokenize("A D +"));
+    EXPECT_THROW(flat.evaluate(bindings), std::runtime_error);
+}
+
+// Test that a saved tree loads into another symbol table unchanged
+TEST_F(FlatTreeTest, SaveAndLoad) {
+    FlatTree flat;
+    flat.buildFromPrefix(expressionTree, tokenize("* - C 0.250 + A ^ B 2"));
+    std::stringstream stream;
+    flat.save(stream);
+
+    ExpressionTree other;
+    other.symbols->intern("Z");  // Shift the ids so they must be remapped
+    FlatTree loaded;
+    loaded.load(stream, *other.symbols);
+    EXPECT_EQ(loaded.preorder(), "* - C 0.250 + A ^ B 2");
+    EXPECT_EQ(loaded.inorder(), flat.inorder());
+
+    VariableBindings otherBindings;
+    otherBindings.set(other.symbols->find("A"), 1.5);
+    otherBindings.set(other.symbols->find("B"), -2);
+    otherBindings.set(other.symbols->find("C"), 7);
+    EXPECT_DOUBLE_EQ(loaded.evaluate(otherBindings), flat.evaluate(bindings));
+
+    std::string data = stream.str();
+    std::istringstream truncated(data.substr(0, data.size() / 2));
+    EXPECT_THROW(loaded.load(truncated, *other.symbols), std::runtime_error);
+    std::istringstream garbage("not a tree");
+    EXPECT_THROW(loaded.load(garbage, *other.symbols), std::runtime_error);
+}
+
+// Test that load rejects a huge node count and children that are not the operator's operands
+TEST_F(FlatTreeTest, LoadRejectsCorruptData) {
+    FlatTree flat;
+    flat.buildFromPostfix(expressionTree, tokenize("A B C * +"));
+    std::stringstream stream;
+    flat.save(stream);
+    const std::string data = stream.str();
+    FlatTree loaded;
+
+    // A count near the limit with almost no data behind it fails on the short read.
+    std::string huge = data;
+    const uint64_t count = 0xFFFFFFF0u;
+    huge.replace(4, sizeof(count), reinterpret_cast<const char*>(&count), sizeof(count));
+    std::istringstream hugeStream(huge);
+    EXPECT_THROW(loaded.load(hugeStream, *expressionTree.symbols), std::runtime_error);
+
+    // "+" reading (*, A) instead of (A, *) keeps every child before its parent, but is not post-order.
+    std::string swapped = data;
+    const size_t leftOffset = 4 + sizeof(uint64_t) + 1 + 5 * sizeof(NodeTag) + 5 * sizeof(double);
+    const uint32_t children[2] = {3, 0};
+    swapped.replace(leftOffset + 4 * sizeof(uint32_t), sizeof(uint32_t), reinterpret_cast<const char*>(&children[0]),
+                    sizeof(uint32_t));
+    swapped.replace(leftOffset + 9 * sizeof(uint32_t), sizeof(uint32_t), reinterpret_cast<const char*>(&children[1]),
+                    sizeof(uint32_t));
+    std::istringstream swappedStream(swapped);
+    EXPECT_THROW(loaded.load(swappedStream, *expressionTree.symbols), std::runtime_error);
+
+    std::istringstream intact(data);
+    loaded.load(intact, *expressionTree.symbols);
+    EXPECT_EQ(loaded.inorder(), "( A + ( B * C ) )");
+}
+
+// Test that copies evaluate from several threads at once
+TEST_F(FlatTreeTest, ConcurrentEvaluation) {
+    FlatTree flat;
+    flat.buildFromInfix(expressionTree, tokenize("( A + B ) * ( C - 2 ) ^ 2"));
+    const double expected = flat.evaluate(bindings);
+    std::vector<double> results(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t, copy = flat]() {
+            for (int i = 0; i < 1000; ++i) results[t] = copy.evaluate(bindings);
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    for (double result : results) EXPECT_DOUBLE_EQ(result, expected);
+}
+
+// Test that sharing stores a repeated subexpression once and writes it at every use
+TEST_F(FlatTreeTest, SharesSubexpressions) {
+    const std::string text = "( A * B + C ) ^ 2 - ( A * B + C ) / D";
+    FlatTree tree;
+    tree.buildFromInfix(expressionTree, tokenize(text));
+    FlatTree dag(true);
+    dag.buildFromInfix(expressionTree, tokenize(text));
+    EXPECT_FALSE(tree.isShared());
+    EXPECT_TRUE(dag.isShared());
+    EXPECT_EQ(tree.size(), 15u);
+    EXPECT_EQ(dag.size(), 10u);  // A B * C + 2 ^ D / -
+    // Both sides of the - read the same A * B + C node.
+    const uint32_t power = dag.leftChild(dag.root());
+    const uint32_t quotient = dag.rightChild(dag.root());
+    EXPECT_EQ(dag.tag(power), NodeTag::Power);
+    EXPECT_EQ(dag.tag(quotient), NodeTag::Divide);
+    EXPECT_EQ(dag.leftChild(power), dag.leftChild(quotient));
+
+    EXPECT_EQ(dag.inorder(), tree.inorder());
+    EXPECT_EQ(dag.preorder(), tree.preorder());
+    EXPECT_EQ(dag.postorder(), tree.postorder());
+    bindings.set(expressionTree.symbols->intern("D"), 4);
+    EXPECT_DOUBLE_EQ(dag.evaluate(bindings), tree.evaluate(bindings));
+
+    // The DAG survives a save and load.
+    std::stringstream stream;
+    dag.save(stream);
+    FlatTree loaded;
+    loaded.load(stream, *expressionTree.symbols);
+    EXPECT_TRUE(loaded.isShared());
+    EXPECT_EQ(loaded.size(), 10u);
+    EXPECT_EQ(loaded.postorder(), tree.postorder());
+    EXPECT_DOUBLE_EQ(loaded.evaluate(bindings), tree.evaluate(bindings));
+}
+
+// Test that every builder gives the tree's traversals and value when sharing
+TEST_F(FlatTreeTest, SharedMatchesTree) {
+    ExpressionGenerator generator(33, {"+", "-", "*"}, {"A", "B", "2"});
+    FlatTree tree;
+    FlatTree dag(true);
+    for (int round = 0; round < 100; ++round) {
+        std::string text = generator.nested(7, 6);
+        if (text[0] != '(') continue;
+        tree.buildFromInfix(expressionTree, tokenize(text));
+        const std::string prefix = tree.preorder();
+        const std::string postfix = tree.postorder();
+        dag.buildFromInfix(expressionTree, tokenize(text));
+        EXPECT_LE(dag.size(), tree.size());
+        EXPECT_EQ(dag.inorder(), tree.inorder()) << text;
+        EXPECT_EQ(dag.preorder(), prefix) << text;
+        EXPECT_EQ(dag.postorder(), postfix) << text;
+        EXPECT_DOUBLE_EQ(dag.evaluate(bindings), tree.evaluate(bindings)) << text;
+
+        dag.buildFromPrefix(expressionTree, tokenize(prefix));
+        EXPECT_EQ(dag.postorder(), postfix) << prefix;
+        dag.buildFromPostfix(expressionTree, tokenize(postfix));
+        EXPECT_EQ(dag.preorder(), prefix) << postfix;
+        EXPECT_DOUBLE_EQ(dag.evaluate(bindings), tree.evaluate(bindings)) << postfix;
+    }
+}
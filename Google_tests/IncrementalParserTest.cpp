@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "ExpressionTree.h"
+#include "IncrementalParser.h"
+
+class IncrementalParserTest : public ::testing::Test {
+protected:
+    ExpressionTree expressionTree;
+    IncrementalParser parser{expressionTree};
+
+    // Checks the incremental tree against a fresh parse of the current text
+    void expectMatchesFreshParse() {
+        ExpressionTree::TreeHandle fresh = expressionTree.buildTreeFromInfix(parser.text());
+        EXPECT_EQ(expressionTree.postorder(parser.getRoot()), expressionTree.postorder(fresh.get())) << parser.text();
+    }
+};
+
+// Test that token-for-token edits patch nodes in place
+TEST_F(IncrementalParserTest, PatchesInPlace) {
+    ExpressionTree::TreeNode* root = parser.parse("A + B * 3");
+    ExpressionTree::TreeNode* rightChild = root->right;
+    EXPECT_EQ(parser.edit(8, 1, "42"), root);
+    EXPECT_EQ(parser.lastReparsedTokens(), 0);
+    EXPECT_EQ(parser.edit(2, 1, "-"), root);
+    EXPECT_EQ(parser.edit(0, 1, "Total"), root);
+    EXPECT_EQ(parser.text(), "Total - B * 42");
+    EXPECT_EQ(root->right, rightChild);
+    EXPECT_EQ(expressionTree.spelling(root->left), "Total");
+    EXPECT_DOUBLE_EQ(root->right->right->number, 42.0);
+    expectMatchesFreshParse();
+}
+
+// Test that edits inside parentheses reparse only the innermost group
+TEST_F(IncrementalParserTest, ReparsesInnermostGroup) {
+    std::string expression = "X";
+    for (int i = 0; i < 2000; ++i) expression += " + Y" + std::to_string(i);
+    expression += " * ( A - ( B + C ) )";
+    ExpressionTree::TreeNode* root = parser.parse(expression);
+
+    size_t inner = parser.text().find("B + C");
+    parser.edit(inner, 5, "B * C ^ 2");
+    EXPECT_EQ(parser.getRoot(), root);
+    EXPECT_EQ(parser.lastReparsedTokens(), 5);
+    expectMatchesFreshParse();
+
+    size_t outer = parser.text().find("A -");
+    parser.edit(outer, 3, "A / D %");
+    EXPECT_EQ(parser.lastReparsedTokens(), 11);
+    expectMatchesFreshParse();
+
+    // Outside every group only the operand and its new operator are parsed.
+    parser.edit(0, 1, "X ^ 2");
+    EXPECT_EQ(parser.lastReparsedTokens(), 3);
+    EXPECT_EQ(parser.getRoot(), root);
+    expectMatchesFreshParse();
+}
+
+// Test that edits at either end of a long operator chain reparse only the new link
+TEST_F(IncrementalParserTest, SplicesIntoOperatorChain) {
+    std::string expression = "X";
+    for (int i = 0; i < 20000; ++i) expression += " + Y" + std::to_string(i);
+    ExpressionTree::TreeNode* root = parser.parse(expression);
+    ExpressionTree::TreeNode* deepest = root;
+    while (deepest->left->left) deepest = deepest->left;
+
+    parser.edit(parser.text().size(), 0, " + Z");
+    EXPECT_EQ(parser.lastReparsedTokens(), 3);
+    EXPECT_EQ(parser.getRoot(), root);
+    parser.edit(0, 0, "W - ");
+    EXPECT_EQ(parser.lastReparsedTokens(), 3);
+    EXPECT_EQ(parser.getRoot(), root);
+    parser.edit(0, 1, "V * W");
+    EXPECT_EQ(parser.lastReparsedTokens(), 3);
+    parser.edit(0, 4, "");
+    EXPECT_EQ(parser.lastReparsedTokens(), 1);
+    parser.edit(2, 1, "*");
+    EXPECT_EQ(parser.lastReparsedTokens(), 3);
+    EXPECT_EQ(expressionTree.spelling(deepest->left->right), "X");
+    expectMatchesFreshParse();
+
+    // A chain of '^' leans the other way.
+    parser.parse("A ^ B ^ C");
+    root = parser.getRoot();
+    parser.edit(parser.text().size(), 0, " ^ D");
+    EXPECT_EQ(parser.lastReparsedTokens(), 3);
+    parser.edit(0, 0, "Z ^ ");
+    EXPECT_EQ(parser.lastReparsedTokens(), 3);
+    EXPECT_EQ(parser.getRoot(), root);
+    expectMatchesFreshParse();
+}
+
+// Test that edits far apart, without reading the text in between, keep text and tokens in step
+TEST_F(IncrementalParserTest, EditsAcrossGaps) {
+    std::string expected = "A";
+    for (int i = 0; i < 200; ++i) expected += " + B" + std::to_string(i);
+    parser.parse(expected);
+    std::mt19937 random(5);
+    const char* operands[] = {"C", "7", "( D - 1 )", "E2"};
+    for (int i = 0; i < 500; ++i) {
+        size_t offset = expected.find(" + ", random() % expected.size());
+        if (offset == std::string::npos) offset = expected.size();
+        std::string replacement = std::string(random() % 2 ? " * " : " + ") + operands[random() % 4];
+        parser.edit(offset, 0, replacement);
+        expected.insert(offset, replacement);
+    }
+    EXPECT_EQ(parser.text(), expected);
+    TokenList tokens;
+    expressionTree.tokenize(expected, tokens);
+    ASSERT_EQ(parser.getTokens().getSize(), tokens.getSize());
+    for (int i = 0; i < tokens.getSize(); ++i) EXPECT_EQ(parser.getTokens()[i].offset, tokens[i].offset);
+    expectMatchesFreshParse();
+}
+
+// Test that an invalid edit is undone and reported
+TEST_F(IncrementalParserTest, RejectsInvalidEdit) {
+    parser.parse("( A + B ) * C");
+    std::string before = expressionTree.postorder(parser.getRoot());
+    try {
+        parser.edit(4, 1, "+ *");
+        FAIL() << "expected an error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_STREQ(e.what(), "Invalid syntax: Consecutive operators");
+    }
+    EXPECT_EQ(parser.text(), "( A + B ) * C");
+    EXPECT_EQ(expressionTree.postorder(parser.getRoot()), before);
+    EXPECT_THROW(parser.edit(0, 1, ""), std::runtime_error);
+    EXPECT_THROW(parser.edit(20, 1, "x"), std::out_of_range);
+    parser.edit(6, 1, "B-1");
+    expectMatchesFreshParse();
+}
+
+// Test random edits against fresh parses
+TEST_F(IncrementalParserTest, RandomEdits) {
+    std::mt19937 random(3);
+    const char* pieces[] = {"A", "7", "-2", "+", "-", "*", "^", "(", ")", " ", "B1", "( C + 1 )", "0.5"};
+    parser.parse("( A + 1 ) * ( B - ( C / 2 ) ) ^ D");
+    int applied = 0;
+    for (int i = 0; i < 3000; ++i) {
+        const std::string& text = parser.text();
+        size_t offset = random() % (text.size() + 1);
+        size_t length = std::min<size_t>(random() % 4, text.size() - offset);
+        std::string replacement = random() % 4 ? pieces[random() % 13] : "";
+        std::string expected = text;
+        expected.replace(offset, length, replacement);
+
+        bool valid = true;
+        try {
+            TokenList tokens;
+            expressionTree.tokenize(expected, tokens);
+            expressionTree.buildTreeFromInfix(tokens);
+        } catch (const std::runtime_error&) {
+            valid = false;
+        }
+        std::string before = text;
+        if (valid) {
+            parser.edit(offset, length, replacement);
+            ASSERT_EQ(parser.text(), expected);
+            ++applied;
+        } else {
+            EXPECT_THROW(parser.edit(offset, length, replacement), std::runtime_error);
+            ASSERT_EQ(parser.text(), before);
+        }
+        TokenList tokens;
+        expressionTree.tokenize(parser.text(), tokens);
+        ExpressionTree::TreeHandle fresh = expressionTree.buildTreeFromInfix(tokens);
+        ASSERT_EQ(expressionTree.postorder(parser.getRoot()), expressionTree.postorder(fresh.get())) << parser.text();
+    }
+    EXPECT_GT(applied, 100);
+}
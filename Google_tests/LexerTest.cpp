@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include "Lexer.h"
+
+class LexerTest : public ::testing::Test {
+};
+
+// Test that tokens are views into the original input
+TEST_F(LexerTest, TokensPointIntoInput) {
+    std::string input = "( AX + 3.5 )";
+    Lexer lexer(input);
+    std::string_view token;
+
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token, "(");
+    EXPECT_EQ(token.data(), input.data());
+
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token, "AX");
+    EXPECT_EQ(token.data(), input.data() + 2);
+
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token, "+");
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token, "3.5");
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token, ")");
+    EXPECT_FALSE(lexer.next(token));
+}
+
+// Test negative numbers and a lone minus sign
+TEST_F(LexerTest, NegativeNumbers) {
+    Lexer lexer("-5 - -0.75");
+    std::string_view token;
+
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token, "-5");
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token, "-");
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token, "-0.75");
+    EXPECT_FALSE(lexer.next(token));
+}
+
+// Test that compact input without spaces is split correctly
+TEST_F(LexerTest, CompactInput) {
+    Lexer lexer("A+B*(C-D)/-2.5^x1%-(3)");
+    const char* expected[] = {"A", "+", "B", "*", "(", "C", "-", "D", ")", "/", "-2.5",
+                              "^", "x1", "%", "-", "(", "3", ")"};
+    std::string_view token;
+
+    for (const char* text : expected) {
+        ASSERT_TRUE(lexer.next(token));
+        EXPECT_EQ(token, text);
+    }
+    EXPECT_FALSE(lexer.next(token));
+}
+
+// Test that a minus after an operand is subtraction unless it follows whitespace
+TEST_F(LexerTest, MinusAfterOperand) {
+    Lexer lexer("5-3 5 -3 (2)-1");
+    const char* expected[] = {"5", "-", "3", "5", "-3", "(", "2", ")", "-", "1"};
+    std::string_view token;
+
+    for (const char* text : expected) {
+        ASSERT_TRUE(lexer.next(token));
+        EXPECT_EQ(token, text);
+    }
+    EXPECT_FALSE(lexer.next(token));
+}
+
+// Test that malformed runs come back as single tokens
+TEST_F(LexerTest, InvalidRuns) {
+    Lexer lexer("3.14.5+1x $ x-y");
+    const char* expected[] = {"3.14.5", "+", "1x", "$", "x", "-", "y"};
+    std::string_view token;
+
+    for (const char* text : expected) {
+        ASSERT_TRUE(lexer.next(token));
+        EXPECT_EQ(token, text);
+    }
+    EXPECT_FALSE(lexer.next(token));
+}
+
+// Test that tokens are classified once with kind, operator code, value and span
+TEST_F(LexerTest, TypedTokens) {
+    std::string input = "AX*(-2.5+7)";
+    Lexer lexer(input);
+    Token token;
+
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token.kind, TokenKind::Variable);
+    EXPECT_EQ(token.offset, 0u);
+    EXPECT_EQ(token.length, 2u);
+
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token.kind, TokenKind::Operator);
+    EXPECT_EQ(token.op, OpCode::Multiply);
+
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token.kind, TokenKind::LeftParen);
+
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token.kind, TokenKind::Number);
+    EXPECT_DOUBLE_EQ(token.number, -2.5);
+    EXPECT_EQ(token.offset, 4u);
+    EXPECT_EQ(token.length, 4u);
+
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token.op, OpCode::Add);
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_DOUBLE_EQ(token.number, 7.0);
+    ASSERT_TRUE(lexer.next(token));
+    EXPECT_EQ(token.kind, TokenKind::RightParen);
+    EXPECT_FALSE(lexer.next(token));
+}
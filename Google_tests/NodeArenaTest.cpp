@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "NodeArena.h"
+
+// Trivially destructible node, as released without a destructor pass
+struct PlainNode {
+    double value;
+    PlainNode* left;
+    PlainNode* right;
+};
+
+class NodeArenaTest : public ::testing::Test {};
+
+// Test that destroyed slots are reused before new ones are bumped
+TEST_F(NodeArenaTest, ReusesDestroyedSlots) {
+    NodeArena<PlainNode> arena;
+    PlainNode* first = arena.create(PlainNode{1.0, nullptr, nullptr});
+    PlainNode* second = arena.create(PlainNode{2.0, first, nullptr});
+    EXPECT_EQ(second->left, first);
+    EXPECT_EQ(arena.size(), 2u);
+    arena.destroy(first);
+    PlainNode* third = arena.create(PlainNode{3.0, nullptr, nullptr});
+    EXPECT_EQ(third, first);
+    EXPECT_EQ(arena.size(), 2u);
+    EXPECT_EQ(arena.blockCount(), 1u);
+
+    // Blocks grow as nodes are added and are all kept until release.
+    std::vector<PlainNode*> nodes;
+    for (int i = 0; i < 100000; ++i) nodes.push_back(arena.create(PlainNode{double(i), nullptr, nullptr}));
+    for (int i = 0; i < 100000; ++i) EXPECT_EQ(nodes[i]->value, double(i));
+    EXPECT_LT(arena.blockCount(), 100u);
+    arena.release();
+    EXPECT_EQ(arena.size(), 0u);
+    EXPECT_EQ(arena.blockCount(), 0u);
+}
+
+// Test that release drops every block, live and destroyed nodes alike, and starts over
+TEST_F(NodeArenaTest, ReleaseDropsWholeBlocks) {
+    NodeArena<PlainNode> arena;
+    std::vector<PlainNode*> nodes;
+    for (int i = 0; i < 1000; ++i) nodes.push_back(arena.create(PlainNode{double(i), nullptr, nullptr}));
+    for (int i = 0; i < 1000; i += 2) arena.destroy(nodes[i]);
+    EXPECT_EQ(arena.size(), 500u);
+    EXPECT_EQ(arena.releaseCount(), 0u);
+    arena.release();
+    EXPECT_EQ(arena.size(), 0u);
+    EXPECT_EQ(arena.blockCount(), 0u);
+    EXPECT_EQ(arena.releaseCount(), 1u);
+
+    // Nothing from before the release is handed out again.
+    PlainNode* fresh = arena.create(PlainNode{1.0, nullptr, nullptr});
+    EXPECT_EQ(arena.size(), 1u);
+    EXPECT_EQ(arena.blockCount(), 1u);
+    EXPECT_EQ(fresh->value, 1.0);
+}
+
+// Test that adopting an arena takes over its nodes and free slots
+TEST_F(NodeArenaTest, AdoptsOtherArena) {
+    NodeArena<PlainNode> arena;
+    PlainNode* kept = arena.create(PlainNode{1.0, nullptr, nullptr});
+    {
+        NodeArena<PlainNode> other;
+        PlainNode* moved = other.create(PlainNode{2.0, nullptr, nullptr});
+        PlainNode* freed = other.create(PlainNode{3.0, nullptr, nullptr});
+        other.destroy(freed);
+        arena.adopt(other);
+        EXPECT_EQ(other.size(), 0u);
+        EXPECT_EQ(other.blockCount(), 0u);
+        kept->left = moved;
+        EXPECT_EQ(arena.create(PlainNode{4.0, nullptr, nullptr}), freed);
+    }
+    EXPECT_EQ(kept->left->value, 2.0);
+    EXPECT_EQ(arena.size(), 3u);
+    EXPECT_EQ(arena.blockCount(), 2u);
+}
+
+// Test that a run is contiguous, in the given order, and freed with the arena
+TEST_F(NodeArenaTest, CreatesContiguousRuns) {
+    NodeArena<PlainNode> arena;
+    PlainNode* before = arena.create(PlainNode{-1.0, nullptr, nullptr});
+    PlainNode* run = arena.createRun(5, [](size_t i) { return PlainNode{double(i), nullptr, nullptr}; });
+    PlainNode* after = arena.create(PlainNode{-2.0, nullptr, nullptr});
+    EXPECT_EQ(after, before + 1);  // The run has its own block
+    for (int i = 0; i < 5; ++i) EXPECT_EQ(run[i].value, double(i));
+    EXPECT_EQ(arena.createRun(0, [](size_t) { return PlainNode{0.0, nullptr, nullptr}; }), nullptr);
+    EXPECT_EQ(arena.size(), 7u);
+    EXPECT_EQ(arena.blockCount(), 2u);
+
+    // A run's block goes back when its last node does; its slots are not reused before that.
+    arena.destroy(run + 2);
+    EXPECT_NE(arena.create(PlainNode{9.0, nullptr, nullptr}), run + 2);
+    for (int i : {0, 1, 3, 4}) arena.destroy(run + i);
+    EXPECT_EQ(arena.size(), 3u);
+    EXPECT_EQ(arena.blockCount(), 1u);
+
+    // Runs adopted from another arena are tracked the same way.
+    NodeArena<PlainNode> other;
+    PlainNode* adopted = other.createRun(3, [](size_t i) { return PlainNode{double(i), nullptr, nullptr}; });
+    arena.adopt(other);
+    EXPECT_EQ(arena.blockCount(), 2u);
+    for (int i = 0; i < 3; ++i) arena.destroy(adopted + i);
+    EXPECT_EQ(arena.blockCount(), 1u);
+    arena.release();
+    EXPECT_EQ(arena.size(), 0u);
+}
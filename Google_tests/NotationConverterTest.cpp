@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include "ExpressionTree.h"
+#include "NotationConverter.h"
+#include "TestExpressions.h"
+
+class NotationConverterTest : public ::testing::Test {
+protected:
+    ExpressionTree expressionTree;
+    NotationConverter converter{expressionTree};
+
+    // Runs one conversion into a string
+    std::string convert(const std::string& text,
+                        void (NotationConverter::*conversion)(const TokenList&, TokenWriter&)) {
+        TokenList tokens;
+        expressionTree.tokenize(text, tokens);
+        std::string output;
+        StringTokenWriter writer(output);
+        (converter.*conversion)(tokens, writer);
+        return output;
+    }
+
+    // Checks every conversion out of an infix expression against the tree traversals
+    void expectSameAsTree(const std::string& infix) {
+        ExpressionTree::TreeHandle root = expressionTree.buildTreeFromInfix(infix);
+        std::string inorder = expressionTree.inorder(root.get());
+        std::string preorder = expressionTree.preorder(root.get());
+        std::string postorder = expressionTree.postorder(root.get());
+
+        EXPECT_EQ(convert(infix, &NotationConverter::infixToPostfix), postorder) << infix;
+        EXPECT_EQ(convert(infix, &NotationConverter::infixToPrefix), preorder) << infix;
+        EXPECT_EQ(convert(preorder, &NotationConverter::prefixToPostfix), postorder) << infix;
+        EXPECT_EQ(convert(preorder, &NotationConverter::prefixToInfix), inorder) << infix;
+        EXPECT_EQ(convert(postorder, &NotationConverter::postfixToPrefix), preorder) << infix;
+        EXPECT_EQ(convert(postorder, &NotationConverter::postfixToInfix), inorder) << infix;
+    }
+};
+
+// Test that conversions match building a tree and traversing it
+TEST_F(NotationConverterTest, MatchesTreeTraversals) {
+    EXPECT_EQ(convert("( A + B ) * C", &NotationConverter::infixToPostfix), "A B + C *");
+    EXPECT_EQ(convert("A - B - C", &NotationConverter::infixToPrefix), "- - A B C");
+    EXPECT_EQ(convert("2 3 2 ^ ^", &NotationConverter::postfixToInfix), "( 2 ^ ( 3 ^ 2 ) )");
+
+    const char* expressions[] = {"A + B * C", "(A + B) * C", "2 ^ 3 ^ 2", "A - B - C", "A / (B - C) % D ^ E",
+                                 "((X))*-2", "1-2*3+4/5^6^7%8", "A ^ B * C ^ D ^ E - F"};
+    for (const char* text : expressions) expectSameAsTree(text);
+
+    // Random expressions with every operator and nested groups
+    ExpressionGenerator generator(3, {"+", "-", "*", "/", "%", "^"}, {"X0", "X1", "X2", "X3", "7", "7", "7", "7"});
+    for (int round = 0; round < 200; ++round) {
+        std::string text = generator.nested(6, 4, 3);
+        if (text.find(' ') != std::string::npos) expectSameAsTree(text);
+    }
+}
+
+// Test that invalid input is rejected with the validators' messages
+TEST_F(NotationConverterTest, ReportsErrors) {
+    auto errorOf = [&](const std::string& text, void (NotationConverter::*conversion)(const TokenList&, TokenWriter&)) {
+        try {
+            convert(text, conversion);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    EXPECT_EQ(errorOf("A * ( B + C", &NotationConverter::infixToPostfix), "Unbalanced parentheses");
+    EXPECT_EQ(errorOf("A + * B", &NotationConverter::infixToPrefix), "Invalid syntax: Consecutive operators");
+    EXPECT_EQ(errorOf("+ A B C", &NotationConverter::prefixToInfix),
+              "Invalid prefix expression: Incorrect number of operands");
+    EXPECT_EQ(errorOf("- * A B", &NotationConverter::prefixToPostfix),
+              "Prefix validation error: Insufficient operands for operator '-'");
+    EXPECT_EQ(errorOf("+ A ( B", &NotationConverter::prefixToInfix), "Invalid token in prefix expression: (");
+    EXPECT_EQ(errorOf("A B ) +", &NotationConverter::postfixToPrefix), "Invalid token in postfix expression: )");
+    EXPECT_EQ(errorOf("A B +", &NotationConverter::prefixToPostfix),
+              "Incorrect expression type. Expected Prefix, but got Postfix expression.");
+}
+
+// Test writing a deeply nested conversion to a stream
+TEST_F(NotationConverterTest, DeepExpressionToStream) {
+    const int depth = 100000;
+    std::string prefix;
+    for (int i = 0; i < depth; ++i) prefix += "- ";
+    prefix += "1";
+    for (int i = 0; i < depth; ++i) prefix += " 2";
+
+    TokenList tokens;
+    expressionTree.tokenize(prefix, tokens);
+    std::ostringstream output;
+    StreamTokenWriter writer(output);
+    converter.prefixToPostfix(tokens, writer);
+    std::string postfix = output.str();
+    EXPECT_EQ(postfix.size(), prefix.size());
+    EXPECT_EQ(postfix.substr(0, 9), "1 2 - 2 -");
+}
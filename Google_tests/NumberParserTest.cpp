@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include "NumberParser.h"
+
+class NumberParserTest : public ::testing::Test {
+protected:
+    // Parses text with NumberParser and checks it matches strtod bit for bit
+    void expectSameAsStrtod(const std::string& text) {
+        double parsed = 0;
+        ASSERT_TRUE(NumberParser::parse(text, parsed)) << text;
+        double expected = std::strtod(text.c_str(), nullptr);
+        EXPECT_EQ(std::memcmp(&parsed, &expected, sizeof(double)), 0) << text;
+    }
+};
+
+// Test plain literals, including ones on the eight-digit path
+TEST_F(NumberParserTest, SimpleLiterals) {
+    double value = 0;
+    EXPECT_TRUE(NumberParser::parse("42", value));
+    EXPECT_EQ(value, 42.0);
+    EXPECT_TRUE(NumberParser::parse("-2.5", value));
+    EXPECT_EQ(value, -2.5);
+    EXPECT_TRUE(NumberParser::parse("12345678901234567", value));
+    EXPECT_EQ(value, 12345678901234567.0);
+    EXPECT_TRUE(NumberParser::parse(".5", value));
+    EXPECT_EQ(value, 0.5);
+    EXPECT_TRUE(NumberParser::parse("7.", value));
+    EXPECT_EQ(value, 7.0);
+    EXPECT_TRUE(NumberParser::parse("1.5e3", value));
+    EXPECT_EQ(value, 1500.0);
+    EXPECT_TRUE(NumberParser::parse("25E-2", value));
+    EXPECT_EQ(value, 0.25);
+}
+
+// Test that malformed text is rejected and partial parses stop in the right place
+TEST_F(NumberParserTest, RejectsMalformed) {
+    double value = 0;
+    EXPECT_FALSE(NumberParser::parse("", value));
+    EXPECT_FALSE(NumberParser::parse("-", value));
+    EXPECT_FALSE(NumberParser::parse(".", value));
+    EXPECT_FALSE(NumberParser::parse("abc", value));
+    EXPECT_FALSE(NumberParser::parse("1.2.3", value));
+    EXPECT_FALSE(NumberParser::parse("5x", value));
+
+    const char text[] = "3e+x";
+    const char* end = NumberParser::parse(text, text + 4, value);
+    EXPECT_EQ(end, text + 1);
+    EXPECT_EQ(value, 3.0);
+}
+
+// Test hard cases outside the fast path
+TEST_F(NumberParserTest, CorrectRounding) {
+    expectSameAsStrtod("0.1");
+    expectSameAsStrtod("9007199254740993");
+    expectSameAsStrtod("123456789012345678901234567890");
+    expectSameAsStrtod("2.2250738585072011e-308");
+    expectSameAsStrtod("4.9e-324");
+    expectSameAsStrtod("1.7976931348623157e308");
+    expectSameAsStrtod("0.000000000000000000000000000001234");
+    expectSameAsStrtod("00000000000000000000000001.5");
+    expectSameAsStrtod("3.14159265358979323846264338327950288");
+    expectSameAsStrtod("1e37");
+
+    double value = 0;
+    EXPECT_TRUE(NumberParser::parse("1e400", value));
+    EXPECT_TRUE(std::isinf(value));
+    EXPECT_TRUE(NumberParser::parse("-1e-400", value));
+    EXPECT_EQ(value, 0.0);
+}
+
+// Test random literals against strtod
+TEST_F(NumberParserTest, MatchesStrtod) {
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 20000; ++i) {
+        std::string text = std::to_string(random() % 100000000000ULL);
+        if (i % 2) text += "." + std::to_string(random() % 1000000000000ULL);
+        if (i % 3 == 0) text += "e" + std::to_string(static_cast<int>(random() % 80) - 40);
+        if (i % 5 == 0) text = "-" + text;
+        expectSameAsStrtod(text);
+    }
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include "ExpressionTree.h"
+#include "StreamEvaluator.h"
+#include "StreamLexer.h"
+
+class StreamEvaluatorTest : public ::testing::Test {
+protected:
+    ExpressionTree expressionTree;
+    VariableBindings bindings;
+
+    void SetUp() override {
+        bindings.set(expressionTree.symbols->intern("A"), 6);
+        bindings.set(expressionTree.symbols->intern("B"), 4);
+        bindings.set(expressionTree.symbols->intern("C"), 0.5);
+    }
+
+    // Evaluates through the tree for comparison
+    double treeValue(const std::string& text, bool prefix) {
+        TokenList tokens;
+        expressionTree.tokenize(text, tokens);
+        ExpressionTree::TreeHandle root = prefix ? expressionTree.buildTreeFromPrefix(tokens)
+                                                 : expressionTree.buildTreeFromPostfix(tokens);
+        return static_cast<double>(expressionTree.evaluate(root.get(), bindings));
+    }
+
+    // Evaluates without a tree, from memory and from a stream with a tiny chunk size
+    void expectValue(const std::string& text, bool prefix, double expected) {
+        StreamEvaluator evaluator(bindings);
+        TokenList tokens;
+        expressionTree.tokenize(text, tokens);
+        EXPECT_DOUBLE_EQ(prefix ? evaluator.evaluatePrefix(tokens) : evaluator.evaluatePostfix(tokens), expected) << text;
+
+        std::istringstream input(text);
+        StreamLexer lexer(input, expressionTree.symbols, 3);
+        EXPECT_DOUBLE_EQ(prefix ? evaluator.evaluatePrefix(lexer) : evaluator.evaluatePostfix(lexer), expected) << text;
+    }
+
+    // Returns the error both readings report, checking that they agree
+    std::string errorOf(const std::string& text, bool prefix) {
+        StreamEvaluator evaluator(bindings);
+        TokenList tokens;
+        expressionTree.tokenize(text, tokens);
+        std::string inMemory;
+        std::string streamed;
+        try {
+            prefix ? evaluator.evaluatePrefix(tokens) : evaluator.evaluatePostfix(tokens);
+        } catch (const std::runtime_error& e) {
+            inMemory = e.what();
+        }
+        std::istringstream input(text);
+        StreamLexer lexer(input, expressionTree.symbols);
+        try {
+            prefix ? evaluator.evaluatePrefix(lexer) : evaluator.evaluatePostfix(lexer);
+        } catch (const std::runtime_error& e) {
+            streamed = e.what();
+        }
+        EXPECT_EQ(inMemory, streamed) << text;
+        return inMemory;
+    }
+};
+
+// Test that direct evaluation matches evaluation through the tree
+TEST_F(StreamEvaluatorTest, MatchesTreeEvaluation) {
+    expectValue("A B * C -", false, 23.5);
+    expectValue("- * A B C", true, 23.5);
+    expectValue("A B C + ^", false, treeValue("A B C + ^", false));
+    expectValue("^ A + B C", true, treeValue("^ A + B C", true));
+    expectValue("2 3 2 ^ ^", false, 512);
+    expectValue("% 17 5", true, 2);
+
+    // Random expressions in both notations
+    std::mt19937 random(5);
+    const char* operands[] = {"A", "B", "C", "2", "7.25"};
+    const char* operators[] = {"+", "-", "*"};
+    for (int round = 0; round < 50; ++round) {
+        std::string postfix = operands[random() % 5];
+        int pending = 1;
+        for (int i = 0; i < 40; ++i) {
+            if (pending >= 2 && random() % 2) {
+                postfix += std::string(" ") + operators[random() % 3];
+                --pending;
+            } else {
+                postfix += std::string(" ") + operands[random() % 5];
+                ++pending;
+            }
+        }
+        for (; pending > 1; --pending) postfix += " +";
+        TokenList tokens;
+        expressionTree.tokenize(postfix, tokens);
+        ExpressionTree::TreeHandle root = expressionTree.buildTreeFromPostfix(tokens);
+        double expected = static_cast<double>(expressionTree.evaluate(root.get(), bindings));
+        std::string prefix = expressionTree.preorder(root.get());
+        expectValue(postfix, false, expected);
+        expectValue(prefix, true, expected);
+    }
+}
+
+// Test that errors match the tree builders and evaluate()
+TEST_F(StreamEvaluatorTest, ReportsErrors) {
+    EXPECT_EQ(errorOf("+ A", true), "Prefix validation error: Insufficient operands for operator '+'");
+    EXPECT_EQ(errorOf("A +", false), "Postfix validation error: Insufficient operands for operator '+'");
+    EXPECT_EQ(errorOf("+ A B C", true), "Invalid prefix expression: Incorrect number of operands");
+    EXPECT_EQ(errorOf("A B C +", false), "Invalid postfix expression: Incorrect number of operands");
+    EXPECT_EQ(errorOf("", true), "Invalid prefix expression: Incorrect number of operands");
+    EXPECT_EQ(errorOf("A B ) +", false), "Invalid token in postfix expression: )");
+    EXPECT_EQ(errorOf("A D +", false), "Undefined variable: D");
+    EXPECT_EQ(errorOf("/ A 0", true), "Division by zero!");
+    EXPECT_EQ(errorOf("A 0 %", false), "Modulo by zero!");
+}
+
+// Test that errors are raised in reading order, before a later structural error
+TEST_F(StreamEvaluatorTest, ReportsErrorsInReadingOrder) {
+    TokenList tokens;
+    expressionTree.tokenize("1 0 / +", tokens);
+    EXPECT_THROW(expressionTree.buildTreeFromPostfix(tokens), std::runtime_error);
+    EXPECT_EQ(errorOf("1 0 / +", false), "Division by zero!");
+    EXPECT_EQ(errorOf("+ / 1 0", true), "Division by zero!");
+    EXPECT_EQ(errorOf("D 2 3", false), "Undefined variable: D");
+}
+
+// Test that memory follows the nesting depth of a long streamed expression
+TEST_F(StreamEvaluatorTest, LongStream) {
+    const int terms = 200000;
+    std::string postfix = "1";
+    std::string prefix;
+    for (int i = 0; i < terms; ++i) {
+        postfix += " 1 +";
+        prefix += "+ ";
+    }
+    prefix += "1";
+    for (int i = 0; i < terms; ++i) prefix += " 1";
+
+    StreamEvaluator evaluator(bindings);
+    std::istringstream postfixInput(postfix);
+    StreamLexer postfixLexer(postfixInput, expressionTree.symbols, 4096);
+    EXPECT_DOUBLE_EQ(evaluator.evaluatePostfix(postfixLexer), terms + 1);
+    std::istringstream prefixInput(prefix);
+    StreamLexer prefixLexer(prefixInput, expressionTree.symbols, 4096);
+    EXPECT_DOUBLE_EQ(evaluator.evaluatePrefix(prefixLexer), terms + 1);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Lexer.h"
+#include "StreamLexer.h"
+
+class StreamLexerTest : public ::testing::Test {
+protected:
+    // Lexes the whole string at once for comparison
+    static std::vector<Token> lexAll(const std::string& input, SymbolTable& symbols) {
+        std::vector<Token> tokens;
+        Lexer lexer(input, &symbols);
+        Token token;
+        while (lexer.next(token)) tokens.push_back(token);
+        return tokens;
+    }
+
+    // Checks that two token sequences match field by field
+    static void expectSameTokens(const std::vector<Token>& expected, const std::vector<Token>& actual) {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i].kind, actual[i].kind) << "token " << i;
+            EXPECT_EQ(expected[i].op, actual[i].op) << "token " << i;
+            EXPECT_EQ(expected[i].offset, actual[i].offset) << "token " << i;
+            EXPECT_EQ(expected[i].length, actual[i].length) << "token " << i;
+            if (expected[i].kind == TokenKind::Number) {
+                EXPECT_EQ(expected[i].number, actual[i].number);
+            }
+            if (expected[i].kind == TokenKind::Variable) {
+                EXPECT_EQ(expected[i].symbol, actual[i].symbol);
+            }
+        }
+    }
+};
+
+// Test that tokens split across chunk boundaries are reassembled for every chunk size
+TEST_F(StreamLexerTest, MatchesWholeInputLexer) {
+    std::string input = "ALPHA*(-12.375+BETA2)-3 -4 / ( GAMMA^2 ) % 1x  \t 0.5-DELTA";
+    for (size_t chunk = 1; chunk <= 16; ++chunk) {
+        SymbolTable wholeSymbols;
+        SymbolTable streamSymbols;
+        std::vector<Token> expected = lexAll(input, wholeSymbols);
+
+        std::istringstream stream(input);
+        StreamLexer lexer(stream, &streamSymbols, chunk);
+        std::vector<Token> actual;
+        Token token;
+        while (lexer.next(token)) {
+            EXPECT_EQ(lexer.text(), input.substr(token.offset, token.length));
+            actual.push_back(token);
+        }
+        expectSameTokens(expected, actual);
+        // Partial names are never interned
+        EXPECT_EQ(streamSymbols.size(), wholeSymbols.size()) << "chunk " << chunk;
+    }
+}
+
+// Test batched reads from a file descriptor
+TEST_F(StreamLexerTest, BatchesFromDescriptor) {
+    std::string input;
+    for (int i = 0; i < 2000; ++i) input += "( A" + std::to_string(i % 7) + " + " + std::to_string(i) + ".5 ) * ";
+    input += "1";
+
+    FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    std::fwrite(input.data(), 1, input.size(), file);
+    std::fflush(file);
+    std::rewind(file);
+
+    SymbolTable wholeSymbols;
+    SymbolTable streamSymbols;
+    std::vector<Token> expected = lexAll(input, wholeSymbols);
+
+    StreamLexer lexer(fileno(file), &streamSymbols, 4096);
+    std::vector<Token> actual;
+    Token batch[100];
+    size_t count;
+    while ((count = lexer.nextBatch(batch, 100)) > 0) {
+        actual.insert(actual.end(), batch, batch + count);
+    }
+    std::fclose(file);
+
+    expectSameTokens(expected, actual);
+}
+
+// Test an empty and whitespace-only stream
+TEST_F(StreamLexerTest, EmptyInput) {
+    std::istringstream empty("");
+    StreamLexer emptyLexer(empty);
+    Token token;
+    EXPECT_FALSE(emptyLexer.next(token));
+
+    std::istringstream blank("   \n\t  ");
+    StreamLexer blankLexer(blank, nullptr, 2);
+    EXPECT_FALSE(blankLexer.next(token));
+}
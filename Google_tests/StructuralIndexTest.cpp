@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include "Lexer.h"
+#include "StructuralIndex.h"
+
+class StructuralIndexTest : public ::testing::Test {
+protected:
+    // Builds a large expression mixing compact and spaced tokens
+    static std::string largeExpression(int terms) {
+        std::string expression = "( AX1";
+        for (int i = 0; i < terms; ++i) {
+            expression += (i % 3 == 0) ? " + -2.5*( B" : (i % 3 == 1) ? "-x )\t/ 7 " : "%\n( 3^c ) ";
+        }
+        return expression + " )";
+    }
+};
+
+// Test the masks produced for a single block
+TEST_F(StructuralIndexTest, ClassifiesBlock) {
+    std::string block = "A1 + ( 2.5 ) - b\t";
+    block.resize(64, ' ');
+    StructuralIndex::BlockMasks masks = StructuralIndex::classify(block.data());
+
+    EXPECT_EQ(masks.letters, (1ULL << 0) | (1ULL << 15));
+    EXPECT_EQ(masks.digits, (1ULL << 1) | (1ULL << 7) | (1ULL << 8) | (1ULL << 9));
+    EXPECT_EQ(masks.operators, (1ULL << 3) | (1ULL << 13));
+    EXPECT_EQ(masks.open, 1ULL << 5);
+    EXPECT_EQ(masks.close, 1ULL << 11);
+    EXPECT_TRUE(masks.spaces & (1ULL << 16));
+    EXPECT_TRUE(masks.spaces & (1ULL << 63));
+}
+
+// Test that the lexer produces the same tokens with and without the index
+TEST_F(StructuralIndexTest, LexerMatchesWithIndex) {
+    std::string expression = largeExpression(5000);
+    StructuralIndex index;
+    ASSERT_TRUE(index.build(expression));
+    EXPECT_TRUE(index.balancedParentheses());
+
+    Lexer plain(expression);
+    Lexer indexed(expression, nullptr, &index);
+    std::string_view expected, actual;
+    int count = 0;
+    while (plain.next(expected)) {
+        ASSERT_TRUE(indexed.next(actual));
+        ASSERT_EQ(expected, actual);
+        ASSERT_EQ(expected.data(), actual.data());
+        ++count;
+    }
+    EXPECT_FALSE(indexed.next(actual));
+    EXPECT_GT(count, 5000);
+}
+
+// Test the parenthesis check across block boundaries
+TEST_F(StructuralIndexTest, ParenthesisBalance) {
+    StructuralIndex index;
+    std::string nested(100, '(');
+    nested += "1";
+    nested += std::string(100, ')');
+    ASSERT_TRUE(index.build(nested, false));
+    EXPECT_TRUE(index.balancedParentheses());
+    EXPECT_TRUE(index.tokenStarts().empty());
+
+    std::string early = std::string(70, ' ') + ") (";
+    ASSERT_TRUE(index.build(early));
+    EXPECT_FALSE(index.balancedParentheses());
+
+    ASSERT_TRUE(index.build(nested + "("));
+    EXPECT_FALSE(index.balancedParentheses());
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SymbolTable.h"
+
+class SymbolTableTest : public ::testing::Test {
+protected:
+    SymbolTable symbols;
+};
+
+// Test that ids are dense and stable
+TEST_F(SymbolTableTest, DenseIds) {
+    EXPECT_EQ(symbols.intern("AX"), 0u);
+    EXPECT_EQ(symbols.intern("BX"), 1u);
+    EXPECT_EQ(symbols.intern("AX"), 0u);
+    EXPECT_EQ(symbols.size(), 2u);
+    EXPECT_EQ(symbols.name(1), "BX");
+    EXPECT_EQ(symbols.find("CY"), SymbolTable::NoSymbol);
+    EXPECT_THROW(symbols.name(2), std::out_of_range);
+}
+
+// Test growth past the initial table and chunk sizes
+TEST_F(SymbolTableTest, ManyNames) {
+    for (int i = 0; i < 5000; ++i) {
+        EXPECT_EQ(symbols.intern("v" + std::to_string(i)), static_cast<uint32_t>(i));
+    }
+    for (int i = 0; i < 5000; ++i) {
+        std::string name = "v" + std::to_string(i);
+        EXPECT_EQ(symbols.find(name), static_cast<uint32_t>(i));
+        EXPECT_EQ(symbols.name(i), name);
+    }
+}
+
+// Test concurrent interning from several threads
+TEST_F(SymbolTableTest, ConcurrentIntern) {
+    const int threadCount = 4;
+    const int names = 2000;
+    std::vector<std::vector<uint32_t>> ids(threadCount, std::vector<uint32_t>(names));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < names; ++i) {
+                ids[t][i] = symbols.intern("n" + std::to_string((i * (t + 1)) % names));
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    EXPECT_EQ(symbols.size(), static_cast<uint32_t>(names));
+    for (int t = 0; t < threadCount; ++t) {
+        for (int i = 0; i < names; ++i) {
+            EXPECT_EQ(symbols.name(ids[t][i]), "n" + std::to_string((i * (t + 1)) % names));
+        }
+    }
+}
+
+// Test bindings indexed by id
+TEST_F(SymbolTableTest, Bindings) {
+    VariableBindings bindings;
+    EXPECT_EQ(bindings.find(3), nullptr);
+    bindings.set(3, 2.5);
+    ASSERT_NE(bindings.find(3), nullptr);
+    EXPECT_EQ(*bindings.find(3), 2.5);
+    EXPECT_EQ(bindings.find(0), nullptr);
+    EXPECT_EQ(bindings.find(SymbolTable::NoSymbol), nullptr);
+}
@@ -0,0 +1,59 @@
+#ifndef TEST_EXPRESSIONS_H
+#define TEST_EXPRESSIONS_H
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ExpressionTree.h"
+#include "SymbolTable.h"
+
+// Binds the variables the random expressions use: A = 1.5, B = -2, C = 7
+inline void bindTestVariables(ExpressionTree& tree, VariableBindings& bindings) {
+    bindings.set(tree.symbols->intern("A"), 1.5);
+    bindings.set(tree.symbols->intern("B"), -2);
+    bindings.set(tree.symbols->intern("C"), 7);
+}
+
+/*
+ * ExpressionGenerator class: Seeded random infix expressions for the tests that
+ * check one representation or builder against another. Operators and operands
+ * are picked from the given lists, with single spaces between tokens.
+ */
+class ExpressionGenerator {
+private:
+    std::mt19937 random;
+    std::vector<std::string> operators;
+    std::vector<std::string> operands;
+
+    const std::string& pick(const std::vector<std::string>& choices) { return choices[random() % choices.size()]; }
+
+public:
+    // Constructor : Seeds the generator and sets the tokens to choose from
+    ExpressionGenerator(unsigned seed, std::vector<std::string> operatorChoices, std::vector<std::string> operandChoices)
+        : random(seed), operators(std::move(operatorChoices)), operands(std::move(operandChoices)) {}
+
+    // Returns an expression up to depth operators deep; each level stops at an operand
+    // with chance 1 in leafChance, and is parenthesized with chance 1 in groupChance
+    // (always for 1, which gives the fully parenthesized form the traversals write).
+    std::string nested(int depth, unsigned leafChance, unsigned groupChance = 1) {
+        if (depth == 0 || random() % leafChance == 0) return pick(operands);
+        std::string text = nested(depth - 1, leafChance, groupChance) + " " + pick(operators) + " " +
+                           nested(depth - 1, leafChance, groupChance);
+        return random() % groupChance == 0 ? "( " + text + " )" : text;
+    }
+
+    // Returns a flat chain of one to six terms, each an operand or, while budget allows,
+    // a parenthesized chain of half the budget
+    std::string chain(int budget) {
+        std::string text;
+        const int terms = 1 + static_cast<int>(random() % 6);
+        for (int t = 0; t < terms; ++t) {
+            if (t > 0) text += " " + pick(operators) + " ";
+            text += budget > 8 && random() % 3 == 0 ? "(" + chain(budget / 2) + ")" : pick(operands);
+        }
+        return text;
+    }
+};
+
+#endif // TEST_EXPRESSIONS_H
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "ThreadPool.h"
+
+class ThreadPoolTest : public ::testing::Test {
+protected:
+    ThreadPool pool{4};
+};
+
+// Test that every index runs exactly once
+TEST_F(ThreadPoolTest, RunsEveryTask) {
+    EXPECT_EQ(pool.size(), 4u);
+    for (int round = 0; round < 50; ++round) {
+        std::vector<std::atomic<int>> hits(1000);
+        pool.run(hits.size(), [&](size_t i) { hits[i].fetch_add(1); });
+        for (const std::atomic<int>& hit : hits) ASSERT_EQ(hit.load(), 1);
+    }
+}
+
+// Test that an exception in a task reaches the caller and the pool stays usable
+TEST_F(ThreadPoolTest, PropagatesExceptions) {
+    EXPECT_THROW(pool.run(100, [](size_t i) {
+        if (i == 37) throw std::runtime_error("task failed");
+    }), std::runtime_error);
+
+    std::atomic<size_t> total(0);
+    pool.run(100, [&](size_t i) { total += i; });
+    EXPECT_EQ(total.load(), 4950u);
+}
+
+// Test that tasks can start nested batches
+TEST_F(ThreadPoolTest, NestedRun) {
+    std::atomic<int> count(0);
+    pool.run(8, [&](size_t) {
+        pool.run(8, [&](size_t) { count.fetch_add(1); });
+    });
+    EXPECT_EQ(count.load(), 64);
+}
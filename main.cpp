@@ -1,19 +1,16 @@
-#include <chrono>
 #include <functional>
 #include <iostream>
 #include <limits>
-#include <thread>
 #include <unordered_map>
 #include <iomanip>
 #include "Code_lib/ExpressionTree.h"
 using namespace  std;
 /*When entering an expression, follow these guidelines to ensure the program can correctly interpret and process your input:
 
-1. Space-separated Tokens:
-Leave a space between every number, variable, operator, and parenthesis.
+1. Spaces Between Tokens:
+Spaces between numbers, variables, operators, and parentheses are optional.
 Example:
-Correct: A + B * ( C - D )
-Incorrect: A+B*(C-D)
+Both A + B * ( C - D ) and A+B*(C-D) are accepted.
 
 2. Allowed Operators:
 The following operators are supported:
@@ -34,6 +31,8 @@ Note: Two decimal points in a number are not allowed. For example, 3.14.5 is inv
 
 6. Negative Numbers:
 Negative numbers should be entered as -5 or -3.14 with the minus sign directly preceding the number.
+A minus written right after a number, variable, or closing parenthesis is subtraction (5-3 is 5 - 3),
+while a minus that follows a space starts a negative number (5 -3 is the two numbers 5 and -3).
 
 7. Operand Requirement for Binary Operators:
 Don’t miss operands for binary operators (operators that require two operands, like +, -, *, /).
@@ -78,39 +77,18 @@ int main() {
         }
 
         cin.ignore(); // Clear newline
-        cout << "Enter the expression (Please leave spaces between tokens, operators, and parentheses): " <<endl;
+        cout << "Enter the expression: " <<endl;
         getline(cin, input);
 
         try {
-            // Validate parentheses for infix
-            if (choice == 1 && !exprTree.isValidParentheses(input)) {
-                throw runtime_error("Invalid parentheses in the input expression!");
-            }
+            // Parse as the chosen type; every problem in the input is reported at once
+            ExpressionTree::ParseResult result = exprTree.parse(input, choice);
 
-            ExpressionTree::TreeNode* root = nullptr;
+            if (result.ok()) {
+                // The tree keeps the expression until the next one replaces it
+                exprTree.root = std::move(result.root);
+                ExpressionTree::TreeNode* root = exprTree.root.get();
 
-            switch (choice) {
-                case 1: {
-                    MyVector tokens = exprTree.tokenize(input);
-                    exprTree.validateExpressionType(tokens, 1); // Validate as Infix
-                    root = exprTree.buildTreeFromInfix(input);
-                    break;
-                }
-                case 2: {
-                    MyVector tokens = exprTree.tokenize(input);
-                    exprTree.validateExpressionType(tokens, 2); // Validate as Prefix
-                    root = exprTree.buildTreeFromPrefix(tokens);
-                    break;
-                }
-                case 3: {
-                    MyVector tokens = exprTree.tokenize(input);
-                    exprTree.validateExpressionType(tokens, 3); // Validate as Postfix
-                    root = exprTree.buildTreeFromPostfix(tokens);
-                    break;
-                }
-            }
-
-            if (root) {
                 // Display tree traversals
                 cout << "\nInfix: " << exprTree.inorder(root) << endl;
                 cout << "Prefix: " << exprTree.preorder(root) << endl;
@@ -131,14 +109,17 @@ int main() {
                     } catch (const exception& e) {
                         cerr << "Note: " << e.what() << endl;
                     }
-                }   exprTree.deleteTree(root);
+                }
             } else {
-                cout << "Failed to build expression tree! Try to leave spaces between the tokens. For example: ( 5 + 3 ) * 3" << endl;
+                for (const Diagnostic& diagnostic : result.diagnostics) {
+                    cerr << "Error";
+                    if (diagnostic.tokenIndex >= 0) cerr << " at position " << diagnostic.offset + 1;
+                    cerr << ": " << diagnostic.message << endl;
+                }
+                cout << "Failed to build expression tree! Check the expression. For example: ( 5 + 3 ) * 3" << endl;
             }
         } catch (const exception& e) {
             cerr << "Error: " << e.what() << endl;
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-
         }
 
         // Ask to repeat